@@ -3,6 +3,7 @@
 
 #include <string>
 #include <vector>
+#include <memory>
 #include "../bytecode/bytecode.hpp"
 
 struct ASTNode {
@@ -92,6 +93,7 @@ struct FunctionDeclaration : public Statement {
     std::vector<Expression*> default_values;
     std::vector<Statement*> body;
     BytecodeProgram bytecode;
+    std::shared_ptr<CompiledProgram> compiled;
 
     FunctionDeclaration(const std::string& name, const std::vector<std::string>& parameters, const std::vector<Expression*>& default_values, const std::vector<Statement*>& body)
             : name(name), parameters(parameters), default_values(default_values), body(body) {}
@@ -195,6 +197,24 @@ struct ListLiteral : Expression {
     ListLiteral(const std::vector<Expression*>& elements) : elements(elements) {}
 };
 
+struct DictLiteral : Expression {
+    std::vector<Expression*> keys;
+    std::vector<Expression*> values;
+
+    DictLiteral(const std::vector<Expression*>& keys, const std::vector<Expression*>& values)
+            : keys(keys), values(values) {}
+};
+
+// target[start:end]; a bound that was left out is nullptr.
+struct SliceExpression : Expression {
+    Expression* target;
+    Expression* start;
+    Expression* end;
+
+    SliceExpression(Expression* target, Expression* start, Expression* end)
+            : target(target), start(start), end(end) {}
+};
+
 struct ForStatement : Statement {
     std::string variable;
     Expression* iterable;
@@ -0,0 +1,179 @@
+#ifndef ASSEMBLER_HPP
+#define ASSEMBLER_HPP
+
+#include "bytecode.hpp"
+#include "../parser/value.hpp"
+#include "../parser/errors.hpp"
+#include <map>
+#include <memory>
+#include <algorithm>
+
+// Executable form of a BytecodeProgram. Every instruction is one or more
+// 32-bit words whose operands index into the pools below, so LOAD_CONST
+// copies a prebuilt Value and names are stored once per program.
+struct CompiledProgram {
+    std::vector<InstructionWord> code;
+    std::vector<Value> constants;
+    std::vector<std::string> names;
+    std::vector<CallFunctionOperand> calls;
+};
+
+class Assembler {
+public:
+    std::shared_ptr<CompiledProgram> assemble(const BytecodeProgram& program) {
+        auto compiled = std::make_shared<CompiledProgram>();
+        constantIndex.clear();
+        nameIndex.clear();
+
+        offsets.assign(program.size() + 1, 0);
+        size_t offset = 0;
+        for (size_t i = 0; i < program.size(); i++) {
+            offsets[i] = offset;
+            if (program[i].op != LABEL) offset += instructionWords(program[i].op);
+        }
+        offsets[program.size()] = offset;
+        checkOperand(offset);
+
+        compiled->code.reserve(offset);
+        for (const auto& instr : program) {
+            emit(instr, *compiled);
+        }
+        return compiled;
+    }
+
+private:
+    std::map<std::string, uint32_t> constantIndex;
+    std::map<std::string, uint32_t> nameIndex;
+    std::vector<size_t> offsets;
+
+    static uint32_t checkOperand(size_t operand) {
+        if (operand > MAX_INSTRUCTION_OPERAND) {
+            throwRuntimeError("Program too large to encode");
+        }
+        return (uint32_t)operand;
+    }
+
+    uint32_t constant(const Bytecode& instr, CompiledProgram& compiled) {
+        std::string key = "null";
+        Value value;
+        if (auto num = std::get_if<BigNum>(&instr.operand)) {
+            key = "n" + num->to_string();
+            value = Value(*num);
+        } else if (auto str = std::get_if<std::string>(&instr.operand)) {
+            key = "s" + *str;
+            value = Value(*str);
+        }
+
+        auto it = constantIndex.find(key);
+        if (it != constantIndex.end()) return it->second;
+        uint32_t index = checkOperand(compiled.constants.size());
+        compiled.constants.push_back(value);
+        constantIndex[key] = index;
+        return index;
+    }
+
+    uint32_t name(const Bytecode& instr, CompiledProgram& compiled) {
+        const std::string& str = std::get<std::string>(instr.operand);
+        auto it = nameIndex.find(str);
+        if (it != nameIndex.end()) return it->second;
+        uint32_t index = checkOperand(compiled.names.size());
+        compiled.names.push_back(str);
+        nameIndex[str] = index;
+        return index;
+    }
+
+    uint32_t target(const Bytecode& instr) {
+        size_t index = std::get<BigNum>(instr.operand).get_ll();
+        return (uint32_t)offsets[std::min(index, offsets.size() - 1)];
+    }
+
+    static uint32_t binaryOperator(const Bytecode& instr) {
+        return binaryOperatorFromSymbol(std::get<std::string>(instr.operand));
+    }
+
+    static uint32_t storeMode(const Bytecode& instr) {
+        return instr.op == STORE_VAR_KEEP ? 1 : 0;
+    }
+
+    void emit(const Bytecode& instr, CompiledProgram& compiled) {
+        std::vector<InstructionWord>& code = compiled.code;
+        const std::vector<Bytecode>* parts = nullptr;
+        if (auto fused = std::get_if<FusedOperand>(&instr.operand)) parts = &fused->parts;
+
+        switch (instr.op) {
+            case LABEL:
+                break;
+            case LOAD_CONST:
+                code.push_back(encodeInstruction(instr.op, constant(instr, compiled)));
+                break;
+            case LOAD_VAR:
+            case STORE_VAR:
+            case STORE_VAR_KEEP:
+            case LOAD_MEMBER:
+            case STORE_MEMBER:
+            case LOAD_FUNC:
+            case STORE_SUBSCRIPT_VAR:
+            case ADD_VAR:
+                code.push_back(encodeInstruction(instr.op, name(instr, compiled)));
+                break;
+            case BINARY_OP:
+                code.push_back(encodeInstruction(instr.op, binaryOperator(instr)));
+                break;
+            case JUMP:
+            case JUMP_IF_FALSE:
+                code.push_back(encodeInstruction(instr.op, target(instr)));
+                break;
+            case CALL_FUNCTION:
+            case TAIL_CALL:
+                code.push_back(encodeInstruction(instr.op, checkOperand(compiled.calls.size())));
+                compiled.calls.push_back(std::get<CallFunctionOperand>(instr.operand));
+                break;
+            case BUILD_LIST:
+            case BUILD_DICT:
+            case CONCAT_N:
+                code.push_back(encodeInstruction(instr.op, checkOperand(std::get<BigNum>(instr.operand).get_ll())));
+                break;
+            case LOAD_VAR_CONST_BINARY:
+                code.push_back(encodeInstruction(instr.op, name((*parts)[0], compiled)));
+                code.push_back(constant((*parts)[1], compiled));
+                code.push_back(binaryOperator((*parts)[2]));
+                break;
+            case LOAD_VAR_VAR_BINARY:
+                code.push_back(encodeInstruction(instr.op, name((*parts)[0], compiled)));
+                code.push_back(name((*parts)[1], compiled));
+                code.push_back(binaryOperator((*parts)[2]));
+                break;
+            case LOAD_VAR_VAR_SUBSCRIPT:
+                code.push_back(encodeInstruction(instr.op, name((*parts)[0], compiled)));
+                code.push_back(name((*parts)[1], compiled));
+                break;
+            case LOAD_VAR_CONST_BINARY_STORE:
+                code.push_back(encodeInstruction(instr.op, name((*parts)[0], compiled)));
+                code.push_back(constant((*parts)[1], compiled));
+                code.push_back(binaryOperator((*parts)[2]));
+                code.push_back(name((*parts)[3], compiled));
+                code.push_back(storeMode((*parts)[3]));
+                break;
+            case LOAD_VAR_CONST_BINARY_JUMP:
+                code.push_back(encodeInstruction(instr.op, name((*parts)[0], compiled)));
+                code.push_back(constant((*parts)[1], compiled));
+                code.push_back(binaryOperator((*parts)[2]));
+                code.push_back(target((*parts)[3]));
+                break;
+            case BINARY_OP_STORE:
+                code.push_back(encodeInstruction(instr.op, binaryOperator((*parts)[0])));
+                code.push_back(name((*parts)[1], compiled));
+                code.push_back(storeMode((*parts)[1]));
+                break;
+            case BINARY_OP_JUMP_IF_FALSE:
+                code.push_back(encodeInstruction(instr.op, binaryOperator((*parts)[0])));
+                code.push_back(target((*parts)[1]));
+                break;
+            default:
+                code.push_back(encodeInstruction(instr.op));
+                break;
+        }
+    }
+};
+
+#endif
\ No newline at end of file
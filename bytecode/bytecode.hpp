@@ -4,21 +4,29 @@
 #include <vector>
 #include <string>
 #include <variant>
+#include <cstdint>
 #include "../vm/bignum.hpp"
 
 enum BytecodeOp {
     LOAD_CONST,        // 加载常量值（数值/字符串）
     LOAD_VAR,          // 加载变量值
     STORE_VAR,         // 存储到变量
+    STORE_VAR_KEEP,    // 存储到变量并保留栈顶
     BINARY_OP,         // 二元运算（含算术和比较）
     JUMP_IF_FALSE,     // 条件跳转（检测栈顶值）
     CALL_FUNCTION,     // 函数调用
+    TAIL_CALL,         // 尾调用（复用当前栈帧）
     JUMP,              // 无条件跳转（绝对地址）
     RETURN,            // 函数返回
     BUILD_LIST,        // 构建列表
     POP,               // 弹出栈顶元素
     LOAD_SUBSCRIPT,    // 加载列表元素
     STORE_SUBSCRIPT,   // 存储到列表元素
+    STORE_SUBSCRIPT_VAR, // 原地存储到变量中的列表/字典元素
+    SLICE,             // 切片（列表共享元素，字符串复制）
+    BUILD_DICT,        // 构建字典
+    ADD_VAR,           // 变量 += 栈顶（字符串原地追加）
+    CONCAT_N,          // 依次相加栈顶 N 个值（字符串一次拼接）
     CREATE_OBJECT,     // 创建对象
     LOAD_MEMBER,       // 加载对象成员
     STORE_MEMBER,      // 存储到对象成员
@@ -26,23 +34,193 @@ enum BytecodeOp {
     STORE_MEMBER_FUNC, // 存储成员函数到对象
     // CLEAR,             // 清空栈
     RAISE,             // 抛出异常
-    LABEL              // 标签（用于跳转目标）
+    LABEL,             // 标签（用于跳转目标）
+
+    // 超级指令（由 Optimizer 融合常见指令序列生成）
+    LOAD_VAR_CONST_BINARY,       // LOAD_VAR; LOAD_CONST; BINARY_OP
+    LOAD_VAR_VAR_BINARY,         // LOAD_VAR; LOAD_VAR; BINARY_OP
+    LOAD_VAR_VAR_SUBSCRIPT,      // LOAD_VAR; LOAD_VAR; LOAD_SUBSCRIPT
+    LOAD_VAR_CONST_BINARY_STORE, // LOAD_VAR; LOAD_CONST; BINARY_OP; STORE_VAR / STORE_VAR_KEEP
+    LOAD_VAR_CONST_BINARY_JUMP,  // LOAD_VAR; LOAD_CONST; BINARY_OP; JUMP_IF_FALSE
+    BINARY_OP_STORE,             // BINARY_OP; STORE_VAR / STORE_VAR_KEEP
+    BINARY_OP_JUMP_IF_FALSE,     // BINARY_OP; JUMP_IF_FALSE
+
+    // 快速化指令（VM 根据类型反馈原地改写 BINARY_OP / LOAD_SUBSCRIPT，类型不符时退回通用指令）
+    ADD_NUM_NUM,                 // 数值 +
+    SUB_NUM_NUM,                 // 数值 -
+    MUL_NUM_NUM,                 // 数值 *
+    LT_NUM_NUM,                  // 数值 <
+    LE_NUM_NUM,                  // 数值 <=
+    GT_NUM_NUM,                  // 数值 >
+    GE_NUM_NUM,                  // 数值 >=
+    EQ_NUM_NUM,                  // 数值 ==
+    NE_NUM_NUM,                  // 数值 !=
+    ADD_FLOAT_FLOAT,             // 浮点 +
+    SUB_FLOAT_FLOAT,             // 浮点 -
+    MUL_FLOAT_FLOAT,             // 浮点 *
+    DIV_FLOAT_FLOAT,             // 浮点 /
+    LT_FLOAT_FLOAT,              // 浮点 <
+    LE_FLOAT_FLOAT,              // 浮点 <=
+    GT_FLOAT_FLOAT,              // 浮点 >
+    GE_FLOAT_FLOAT,              // 浮点 >=
+    EQ_FLOAT_FLOAT,              // 浮点 ==
+    NE_FLOAT_FLOAT,              // 浮点 !=
+    ADD_STR_STR,                 // 字符串拼接
+    LOAD_SUBSCRIPT_LIST_NUM,     // 列表[数值]
+    LOAD_SUBSCRIPT_DICT          // 字典[键]
+};
+
+inline const char* opcodeName(BytecodeOp op) {
+    switch (op) {
+        case LOAD_CONST: return "LOAD_CONST";
+        case LOAD_VAR: return "LOAD_VAR";
+        case STORE_VAR: return "STORE_VAR";
+        case STORE_VAR_KEEP: return "STORE_VAR_KEEP";
+        case BINARY_OP: return "BINARY_OP";
+        case JUMP_IF_FALSE: return "JUMP_IF_FALSE";
+        case CALL_FUNCTION: return "CALL_FUNCTION";
+        case TAIL_CALL: return "TAIL_CALL";
+        case JUMP: return "JUMP";
+        case RETURN: return "RETURN";
+        case BUILD_LIST: return "BUILD_LIST";
+        case POP: return "POP";
+        case LOAD_SUBSCRIPT: return "LOAD_SUBSCRIPT";
+        case STORE_SUBSCRIPT: return "STORE_SUBSCRIPT";
+        case STORE_SUBSCRIPT_VAR: return "STORE_SUBSCRIPT_VAR";
+        case SLICE: return "SLICE";
+        case BUILD_DICT: return "BUILD_DICT";
+        case ADD_VAR: return "ADD_VAR";
+        case CONCAT_N: return "CONCAT_N";
+        case CREATE_OBJECT: return "CREATE_OBJECT";
+        case LOAD_MEMBER: return "LOAD_MEMBER";
+        case STORE_MEMBER: return "STORE_MEMBER";
+        case LOAD_FUNC: return "LOAD_FUNC";
+        case STORE_MEMBER_FUNC: return "STORE_MEMBER_FUNC";
+        case RAISE: return "RAISE";
+        case LABEL: return "LABEL";
+        case LOAD_VAR_CONST_BINARY: return "LOAD_VAR_CONST_BINARY";
+        case LOAD_VAR_VAR_BINARY: return "LOAD_VAR_VAR_BINARY";
+        case LOAD_VAR_VAR_SUBSCRIPT: return "LOAD_VAR_VAR_SUBSCRIPT";
+        case LOAD_VAR_CONST_BINARY_STORE: return "LOAD_VAR_CONST_BINARY_STORE";
+        case LOAD_VAR_CONST_BINARY_JUMP: return "LOAD_VAR_CONST_BINARY_JUMP";
+        case BINARY_OP_STORE: return "BINARY_OP_STORE";
+        case BINARY_OP_JUMP_IF_FALSE: return "BINARY_OP_JUMP_IF_FALSE";
+        case ADD_NUM_NUM: return "ADD_NUM_NUM";
+        case SUB_NUM_NUM: return "SUB_NUM_NUM";
+        case MUL_NUM_NUM: return "MUL_NUM_NUM";
+        case LT_NUM_NUM: return "LT_NUM_NUM";
+        case LE_NUM_NUM: return "LE_NUM_NUM";
+        case GT_NUM_NUM: return "GT_NUM_NUM";
+        case GE_NUM_NUM: return "GE_NUM_NUM";
+        case EQ_NUM_NUM: return "EQ_NUM_NUM";
+        case NE_NUM_NUM: return "NE_NUM_NUM";
+        case ADD_FLOAT_FLOAT: return "ADD_FLOAT_FLOAT";
+        case SUB_FLOAT_FLOAT: return "SUB_FLOAT_FLOAT";
+        case MUL_FLOAT_FLOAT: return "MUL_FLOAT_FLOAT";
+        case DIV_FLOAT_FLOAT: return "DIV_FLOAT_FLOAT";
+        case LT_FLOAT_FLOAT: return "LT_FLOAT_FLOAT";
+        case LE_FLOAT_FLOAT: return "LE_FLOAT_FLOAT";
+        case GT_FLOAT_FLOAT: return "GT_FLOAT_FLOAT";
+        case GE_FLOAT_FLOAT: return "GE_FLOAT_FLOAT";
+        case EQ_FLOAT_FLOAT: return "EQ_FLOAT_FLOAT";
+        case NE_FLOAT_FLOAT: return "NE_FLOAT_FLOAT";
+        case ADD_STR_STR: return "ADD_STR_STR";
+        case LOAD_SUBSCRIPT_LIST_NUM: return "LOAD_SUBSCRIPT_LIST_NUM";
+        case LOAD_SUBSCRIPT_DICT: return "LOAD_SUBSCRIPT_DICT";
+        default: return "Unknown opcode";
+    }
+}
+
+enum BinaryOperator {
+    OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_MOD, OP_POW,
+    OP_BIT_OR, OP_BIT_AND, OP_BIT_NOT,
+    OP_LT, OP_LE, OP_EQ, OP_NE, OP_GT, OP_GE,
+    OP_AND, OP_OR, OP_INDEX, OP_IN,
+    OP_UNKNOWN
 };
 
+inline const char* binaryOperatorSymbol(BinaryOperator op) {
+    static const char* symbols[] = {
+        "+", "-", "*", "/", "%", "^",
+        "|", "&", "~",
+        "<", "<=", "==", "!=", ">", ">=",
+        "and", "or", "[]", "in",
+        "?"
+    };
+    return symbols[op];
+}
+
+inline BinaryOperator binaryOperatorFromSymbol(const std::string& symbol) {
+    for (int op = 0; op < OP_UNKNOWN; op++) {
+        if (symbol == binaryOperatorSymbol((BinaryOperator)op)) return (BinaryOperator)op;
+    }
+    return OP_UNKNOWN;
+}
+
 struct CallFunctionOperand {
     std::string funcName;
     int argCount;
+    // x = f(x, ...)：若调用到内置函数，先清空变量 x，使其原地修改首个参数
+    std::string inPlaceTarget;
 };
 
 struct VALUE_NULL {
     VALUE_NULL() {}
 };
 
+struct Bytecode;
+
+// 超级指令的操作数：被融合的原始指令序列
+struct FusedOperand {
+    std::vector<Bytecode> parts;
+};
+
 struct Bytecode {
     BytecodeOp op;
-    std::variant<BigNum, std::string, CallFunctionOperand, VALUE_NULL> operand;
+    std::variant<BigNum, std::string, CallFunctionOperand, VALUE_NULL, FusedOperand> operand;
 };
 
 using BytecodeProgram = std::vector<Bytecode>;
 
+// 编码后的指令字：低 8 位为操作码，高 24 位为操作数。
+// 超级指令在首个指令字之后跟随若干完整的 32 位操作数字。
+using InstructionWord = uint32_t;
+
+const uint32_t MAX_INSTRUCTION_OPERAND = (1u << 24) - 1;
+
+inline InstructionWord encodeInstruction(BytecodeOp op, uint32_t operand = 0) {
+    return (InstructionWord)op | (operand << 8);
+}
+
+inline BytecodeOp instructionOp(InstructionWord word) {
+    return (BytecodeOp)(word & 0xFF);
+}
+
+inline uint32_t instructionOperand(InstructionWord word) {
+    return word >> 8;
+}
+
+// 超级指令中的运算符操作数：低 8 位为 BinaryOperator，
+// OPERATOR_QUICK_NUM 位表示该处已观察到两个数值操作数。
+const uint32_t OPERATOR_QUICK_NUM = 1u << 8;
+
+inline BinaryOperator operandOperator(uint32_t operand) {
+    return (BinaryOperator)(operand & 0xFF);
+}
+
+inline size_t instructionWords(BytecodeOp op) {
+    switch (op) {
+        case LOAD_VAR_CONST_BINARY: return 3;
+        case LOAD_VAR_VAR_BINARY: return 3;
+        case LOAD_VAR_VAR_SUBSCRIPT: return 2;
+        case LOAD_VAR_CONST_BINARY_STORE: return 5;
+        case LOAD_VAR_CONST_BINARY_JUMP: return 4;
+        case BINARY_OP_STORE: return 3;
+        case BINARY_OP_JUMP_IF_FALSE: return 2;
+        default: return 1;
+    }
+}
+
+struct CompiledProgram;
+
 #endif
\ No newline at end of file
@@ -4,14 +4,19 @@
 #include "../ast/ast.hpp"
 #include "bytecode.hpp"
 #include <map>
+#include <set>
 #include <utility>
 #include <vector>
 #include <cmath>
+#include <algorithm>
 
 class CodeGen {
 public:
     BytecodeProgram generate(const std::vector<Statement*>& statements) {
         BytecodeProgram program;
+        for (Statement* stmt : statements) {
+            if (auto funcDecl = dynamic_cast<FunctionDeclaration*>(stmt)) declaredFunctions.insert(funcDecl->name);
+        }
         for (Statement* stmt : statements) {
             generateStatement(stmt, program);
         }
@@ -53,6 +58,9 @@ public:
 
 private:
     std::map<std::string, FunctionDeclaration*> functions;
+    // Names of all functions declared in the program being generated,
+    // including those declared after the current statement.
+    std::set<std::string> declaredFunctions;
     std::map<std::string, int> variables;
     std::map<std::string, int> labels;
     std::map<std::string, ClassDeclaration*> classes;
@@ -60,6 +68,7 @@ private:
     int labelCounter = 0;
 
     int tempVarCounter = 0;
+    bool inFunction = false;
 
     void generateStatement(Statement* stmt, BytecodeProgram& program) {
 
@@ -124,13 +133,16 @@ private:
                 throwSyntaxError("Cannot assign to constant '" + assignment->target + "'");
             }
             if (assignment->isSubscriptAssignment) {
-                generateExpression(new Identifier(assignment->target), program);
                 generateExpression(assignment->index, program);
                 generateExpression(assignment->value, program);
-                program.push_back({STORE_SUBSCRIPT, VALUE_NULL()});
-                program.push_back({STORE_VAR, assignment->target});
+                program.push_back({STORE_SUBSCRIPT_VAR, assignment->target});
+            } else if (isSelfAdd(assignment)) {
+                generateSelfAdd(assignment, program);
             } else {
                 generateExpression(assignment->value, program);
+                if (updatesInPlace(assignment) && !program.empty() && program.back().op == CALL_FUNCTION) {
+                    std::get<CallFunctionOperand>(program.back().operand).inPlaceTarget = assignment->target;
+                }
                 program.push_back({STORE_VAR, assignment->target});
             }
         }
@@ -198,6 +210,13 @@ private:
             std::string listVar = "__iter_list_" + std::to_string(tempVarCounter++) + "__";
             program.push_back({STORE_VAR, listVar});
 
+            // The hidden list cannot change inside the loop, so its length is
+            // computed once instead of copying the list for every bound check.
+            std::string lengthVar = "__length_" + std::to_string(tempVarCounter++) + "__";
+            program.push_back({LOAD_VAR, listVar});
+            program.push_back({CALL_FUNCTION, CallFunctionOperand{"len", 1}});
+            program.push_back({STORE_VAR, lengthVar});
+
             std::string indexVar = "__index_" + std::to_string(tempVarCounter++) + "__";
             program.push_back({LOAD_CONST, BigNum(0)});
             program.push_back({STORE_VAR, indexVar});
@@ -213,8 +232,7 @@ private:
 
 
             program.push_back({LOAD_VAR, indexVar});
-            program.push_back({LOAD_VAR, listVar});
-            program.push_back({CALL_FUNCTION, CallFunctionOperand{"len", 1}});
+            program.push_back({LOAD_VAR, lengthVar});
             program.push_back({BINARY_OP, "<"});
             program.push_back({JUMP_IF_FALSE, ctx.breakLabel});
             unresolvedJumps.push_back({program.size() - 1, ctx.breakLabel});
@@ -281,6 +299,8 @@ private:
             functions[funcDecl->name] = funcDecl;
 
             CodeGen funcGen(classes, constants, functions);
+            funcGen.declaredFunctions = declaredFunctions;
+            funcGen.inFunction = true;
             BytecodeProgram funcProgram;
             for (Statement* bodyStmt : funcDecl->body) {
                 funcGen.generateStatement(bodyStmt, funcProgram);
@@ -293,6 +313,11 @@ private:
         }
         else if (auto returnStmt = dynamic_cast<ReturnStatement*>(stmt)) {
             generateExpression(returnStmt->value, program);
+            auto call = dynamic_cast<FunctionCall*>(returnStmt->value);
+            if (inFunction && call && call->name.find('.') == std::string::npos &&
+                !program.empty() && program.back().op == CALL_FUNCTION) {
+                program.back().op = TAIL_CALL;
+            }
             program.push_back({RETURN, 0});
         }
         else if (auto exprStmt = dynamic_cast<ExpressionStatement*>(stmt)) {
@@ -364,6 +389,13 @@ private:
             }
             program.push_back({BUILD_LIST, static_cast<int>(listLit->elements.size())});
         }
+        else if (auto dictLit = dynamic_cast<DictLiteral*>(expr)) {
+            for (size_t i = 0; i < dictLit->keys.size(); i++) {
+                generateExpression(dictLit->keys[i], program);
+                generateExpression(dictLit->values[i], program);
+            }
+            program.push_back({BUILD_DICT, static_cast<int>(dictLit->keys.size())});
+        }
         else if (auto id = dynamic_cast<Identifier*>(expr)) {
             if (constants.count(id->name)) {
                 const Value& constValue = constants[id->name];
@@ -471,6 +503,7 @@ private:
 
                     functions[cls->className + "." + func.second->name] = func.second;
                     CodeGen funcGen(classes, constants, functions);
+                    funcGen.declaredFunctions = declaredFunctions;
                     BytecodeProgram funcProgram;
                     for (Statement* bodyStmt : func.second->body) {
                         funcGen.generateStatement(bodyStmt, funcProgram);
@@ -529,15 +562,106 @@ private:
                 program.push_back({LOAD_SUBSCRIPT, VALUE_NULL()});
             }
         }
+        else if (auto slice = dynamic_cast<SliceExpression*>(expr)) {
+            generateExpression(slice->target, program);
+            for (Expression* bound : {slice->start, slice->end}) {
+                if (bound) {
+                    generateExpression(bound, program);
+                } else {
+                    program.push_back({LOAD_CONST, VALUE_NULL()});
+                }
+            }
+            program.push_back({SLICE, VALUE_NULL()});
+        }
     }
 
     void handleBinaryOp(BinaryExpression* expr, BytecodeProgram& program) {
+        if (expr->op == "+") {
+            std::vector<Expression*> operands = sumOperands(expr);
+            if (isConcatChain(operands)) {
+                for (auto operand : operands) {
+                    generateExpression(operand, program);
+                }
+                program.push_back({CONCAT_N, static_cast<int>(operands.size())});
+                return;
+            }
+        }
         generateExpression(expr->left, program);
         generateExpression(expr->right, program);
 
         program.push_back({BINARY_OP, expr->op});
     }
 
+    // x = append(x, ...) and the other container builtins: once the
+    // arguments are on the stack the old value of x is dead, so releasing
+    // it lets the builtin update the container instead of copying it. The
+    // name may still turn out to be a user function, so the VM decides at
+    // the call whether to release x (see VM::callInPlace).
+    bool updatesInPlace(Assignment* assignment) {
+        static const std::set<std::string> builtins = {"append", "insert", "erase", "remove", "union", "difference", "scale"};
+        auto call = dynamic_cast<FunctionCall*>(assignment->value);
+        if (!call || !builtins.count(call->name) || call->arguments.empty()) {
+            return false;
+        }
+        auto receiver = dynamic_cast<Identifier*>(call->arguments[0]);
+        return receiver && receiver->name == assignment->target;
+    }
+
+    // Terms of the left-deep chain a + b + c + ...
+    static std::vector<Expression*> sumOperands(Expression* expr) {
+        std::vector<Expression*> operands;
+        auto sum = dynamic_cast<BinaryExpression*>(expr);
+        while (sum && sum->op == "+") {
+            operands.push_back(sum->right);
+            expr = sum->left;
+            sum = dynamic_cast<BinaryExpression*>(expr);
+        }
+        operands.push_back(expr);
+        std::reverse(operands.begin(), operands.end());
+        return operands;
+    }
+
+    bool isStringTerm(Expression* expr) {
+        if (dynamic_cast<StringLiteral*>(expr)) return true;
+        auto call = dynamic_cast<FunctionCall*>(expr);
+        return call && (call->name == "str" || call->name == "join") &&
+               !functions.count(call->name) && !declaredFunctions.count(call->name);
+    }
+
+    // A chain of three or more terms becomes one CONCAT_N when a term is
+    // known to be a string: + only accepts a string next to another
+    // string, so the chain either concatenates strings or fails.
+    bool isConcatChain(const std::vector<Expression*>& operands) {
+        return operands.size() >= 3 &&
+               std::any_of(operands.begin(), operands.end(), [&](Expression* term) { return isStringTerm(term); });
+    }
+
+    // x = x + e (or a string chain x = x + e1 + ... + en): the addends are
+    // evaluated first and ADD_VAR adds them to x in place. Nothing in an
+    // expression assigns to x, so reading x last is unobservable. Numeric
+    // literal steps are left to the LOAD_VAR; LOAD_CONST; BINARY_OP;
+    // STORE_VAR superinstruction.
+    bool isSelfAdd(Assignment* assignment) {
+        auto sum = dynamic_cast<BinaryExpression*>(assignment->value);
+        if (!sum || sum->op != "+") return false;
+        std::vector<Expression*> operands = sumOperands(sum);
+        auto first = dynamic_cast<Identifier*>(operands[0]);
+        if (!first || first->name != assignment->target) return false;
+        if (operands.size() == 2) return !dynamic_cast<NumberLiteral*>(operands[1]);
+        return isConcatChain(operands);
+    }
+
+    void generateSelfAdd(Assignment* assignment, BytecodeProgram& program) {
+        std::vector<Expression*> operands = sumOperands(assignment->value);
+        for (size_t i = 1; i < operands.size(); i++) {
+            generateExpression(operands[i], program);
+        }
+        if (operands.size() > 2) {
+            program.push_back({CONCAT_N, static_cast<int>(operands.size() - 1)});
+        }
+        program.push_back({ADD_VAR, assignment->target});
+    }
+
     int createLabel() { return labelCounter++; }
 
     void resolveLabels(BytecodeProgram& program) {
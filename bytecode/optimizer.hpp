@@ -0,0 +1,308 @@
+#ifndef OPTIMIZER_HPP
+#define OPTIMIZER_HPP
+
+#include "bytecode.hpp"
+#include <vector>
+#include <string>
+#include <algorithm>
+
+// Bytecode optimizer run between CodeGen and VM::execute.
+//   -O0: no changes
+//   -O1: strip LABELs, fold constant expressions and branches, thread jump chains
+//   -O2: -O1 plus STORE_VAR x / LOAD_VAR x fusion and superinstructions
+class Optimizer {
+public:
+    explicit Optimizer(int level) : level(level) {}
+
+    void optimize(BytecodeProgram& program) {
+        if (level <= 0) return;
+
+        stripLabels(program);
+        foldConstants(program);
+        while (threadJumps(program)) {}
+
+        if (level >= 2) {
+            fuseStoreLoad(program);
+            fuseSuperinstructions(program);
+        }
+    }
+
+private:
+    int level;
+
+    static bool isJump(const Bytecode& instr) {
+        return instr.op == JUMP || instr.op == JUMP_IF_FALSE ||
+               instr.op == BINARY_OP_JUMP_IF_FALSE || instr.op == LOAD_VAR_CONST_BINARY_JUMP;
+    }
+
+    // Superinstructions keep the jump they absorbed as their last part.
+    static const Bytecode& jumpPart(const Bytecode& instr) {
+        if (auto fused = std::get_if<FusedOperand>(&instr.operand)) return fused->parts.back();
+        return instr;
+    }
+
+    static size_t jumpTarget(const Bytecode& instr) {
+        return std::get<BigNum>(jumpPart(instr).operand).get_ll();
+    }
+
+    static void setJumpTarget(Bytecode& instr, size_t target) {
+        const_cast<Bytecode&>(jumpPart(instr)).operand = BigNum((long long)target);
+    }
+
+    static std::vector<bool> jumpTargets(const BytecodeProgram& program) {
+        std::vector<bool> targets(program.size() + 1, false);
+        for (const auto& instr : program) {
+            if (isJump(instr)) {
+                targets[std::min(jumpTarget(instr), program.size())] = true;
+            }
+        }
+        return targets;
+    }
+
+    // Drops every instruction with keep[i] == false and remaps jump targets.
+    // A jump to a dropped instruction lands on the next kept one.
+    static void compact(BytecodeProgram& program, const std::vector<bool>& keep) {
+        std::vector<size_t> newIndex(program.size() + 1);
+        size_t count = 0;
+        for (size_t i = 0; i < program.size(); i++) {
+            newIndex[i] = count;
+            if (keep[i]) count++;
+        }
+        newIndex[program.size()] = count;
+
+        BytecodeProgram result;
+        result.reserve(count);
+        for (size_t i = 0; i < program.size(); i++) {
+            if (!keep[i]) continue;
+            Bytecode instr = program[i];
+            if (isJump(instr)) {
+                setJumpTarget(instr, newIndex[std::min(jumpTarget(instr), program.size())]);
+            }
+            result.push_back(instr);
+        }
+        program.swap(result);
+    }
+
+    void stripLabels(BytecodeProgram& program) {
+        std::vector<bool> keep(program.size());
+        for (size_t i = 0; i < program.size(); i++) {
+            keep[i] = program[i].op != LABEL;
+        }
+        compact(program, keep);
+    }
+
+    static bool isFoldableConst(const Bytecode& instr) {
+        return instr.op == LOAD_CONST &&
+               (std::holds_alternative<BigNum>(instr.operand) || std::holds_alternative<std::string>(instr.operand));
+    }
+
+    static bool isFalsyConst(const Bytecode& instr) {
+        if (auto num = std::get_if<BigNum>(&instr.operand)) {
+            return *num == 0;
+        }
+        return true;
+    }
+
+    // Mirrors VM::handleBinaryOp for the operators whose result does not
+    // depend on runtime state. Anything that could raise is left to the VM.
+    static bool evaluate(const Bytecode& left, const Bytecode& right, const std::string& op, Bytecode& result) {
+        auto boolean = [&](bool value) {
+            result = {LOAD_CONST, BigNum(value ? 1 : 0)};
+            return true;
+        };
+
+        if (std::holds_alternative<BigNum>(left.operand) && std::holds_alternative<BigNum>(right.operand)) {
+            const BigNum& l = std::get<BigNum>(left.operand);
+            const BigNum& r = std::get<BigNum>(right.operand);
+            auto isInteger = [](const BigNum& n) { return n.trunc() == n; };
+
+            // Fractional results depend on the precision set at run time.
+            bool exact = isInteger(l) && isInteger(r);
+
+            if (op == "+" && exact) result = {LOAD_CONST, l + r};
+            else if (op == "-" && exact) result = {LOAD_CONST, l - r};
+            else if (op == "*" && exact) result = {LOAD_CONST, l * r};
+            else if (op == "%" && r != 0 && exact) result = {LOAD_CONST, l % r};
+            else if (op == "<") return boolean(l < r);
+            else if (op == ">") return boolean(l > r);
+            else if (op == "<=") return boolean(l <= r);
+            else if (op == ">=") return boolean(l >= r);
+            else if (op == "==") return boolean(l == r);
+            else if (op == "!=") return boolean(l != r);
+            else if (op == "and") return boolean(l != 0 && r != 0);
+            else if (op == "or") return boolean(l != 0 || r != 0);
+            else return false;
+            return true;
+        }
+
+        if (std::holds_alternative<std::string>(left.operand) && std::holds_alternative<std::string>(right.operand)) {
+            const std::string& l = std::get<std::string>(left.operand);
+            const std::string& r = std::get<std::string>(right.operand);
+
+            if (op == "+") result = {LOAD_CONST, l + r};
+            else if (op == "<") return boolean(l < r);
+            else if (op == ">") return boolean(l > r);
+            else if (op == "<=") return boolean(l <= r);
+            else if (op == ">=") return boolean(l >= r);
+            else if (op == "==") return boolean(l == r);
+            else if (op == "!=") return boolean(l != r);
+            else return false;
+            return true;
+        }
+
+        return false;
+    }
+
+    // Folds LOAD_CONST a; LOAD_CONST b; BINARY_OP into a single LOAD_CONST,
+    // and LOAD_CONST c; JUMP_IF_FALSE into nothing or an unconditional JUMP.
+    void foldConstants(BytecodeProgram& program) {
+        std::vector<bool> targets = jumpTargets(program);
+        std::vector<bool> keep(program.size(), true);
+        std::vector<size_t> emitted;
+
+        for (size_t i = 0; i < program.size(); i++) {
+            Bytecode& instr = program[i];
+
+            if (instr.op == BINARY_OP && !targets[i] && emitted.size() >= 2) {
+                size_t a = emitted[emitted.size() - 2];
+                size_t b = emitted.back();
+                Bytecode folded;
+                if (!targets[b] && isFoldableConst(program[a]) && isFoldableConst(program[b]) &&
+                    evaluate(program[a], program[b], std::get<std::string>(instr.operand), folded)) {
+                    program[a] = folded;
+                    keep[b] = keep[i] = false;
+                    emitted.pop_back();
+                    continue;
+                }
+            }
+
+            if (instr.op == JUMP_IF_FALSE && !targets[i] && !emitted.empty()) {
+                size_t c = emitted.back();
+                if (program[c].op == LOAD_CONST) {
+                    if (isFalsyConst(program[c])) {
+                        program[c] = {JUMP, instr.operand};
+                    } else {
+                        keep[c] = false;
+                        emitted.pop_back();
+                    }
+                    keep[i] = false;
+                    continue;
+                }
+            }
+
+            emitted.push_back(i);
+        }
+
+        compact(program, keep);
+    }
+
+    // Retargets jumps that land on an unconditional JUMP, removes jumps to
+    // the next instruction and code no jump can reach. Returns true if
+    // anything changed.
+    bool threadJumps(BytecodeProgram& program) {
+        bool changed = false;
+
+        for (auto& instr : program) {
+            if (!isJump(instr)) continue;
+            size_t target = jumpTarget(instr);
+            size_t hops = 0;
+            while (target < program.size() && program[target].op == JUMP && hops++ < program.size()) {
+                target = jumpTarget(program[target]);
+            }
+            if (target != jumpTarget(instr)) {
+                setJumpTarget(instr, target);
+                changed = true;
+            }
+        }
+
+        std::vector<bool> targets = jumpTargets(program);
+        std::vector<bool> keep(program.size(), true);
+        bool removed = false;
+        bool reachable = true;
+        for (size_t i = 0; i < program.size(); i++) {
+            if (targets[i]) reachable = true;
+            if (!reachable) {
+                keep[i] = false;
+                removed = true;
+                continue;
+            }
+            if (program[i].op == JUMP || program[i].op == RETURN) reachable = false;
+            if ((program[i].op != JUMP && program[i].op != JUMP_IF_FALSE) || jumpTarget(program[i]) != i + 1) continue;
+            if (program[i].op == JUMP) {
+                keep[i] = false;
+                removed = true;
+            } else {
+                program[i] = {POP, VALUE_NULL()};
+                changed = true;
+            }
+        }
+
+        if (removed) {
+            compact(program, keep);
+            changed = true;
+        }
+        return changed;
+    }
+
+    void fuseStoreLoad(BytecodeProgram& program) {
+        std::vector<bool> targets = jumpTargets(program);
+        std::vector<bool> keep(program.size(), true);
+
+        for (size_t i = 0; i + 1 < program.size(); i++) {
+            if (program[i].op == STORE_VAR && program[i + 1].op == LOAD_VAR && !targets[i + 1] &&
+                std::get<std::string>(program[i].operand) == std::get<std::string>(program[i + 1].operand)) {
+                program[i].op = STORE_VAR_KEEP;
+                keep[i + 1] = false;
+                i++;
+            }
+        }
+
+        compact(program, keep);
+    }
+
+    // Fuses the most frequent dynamic opcode sequences (see `vlc --opstats`)
+    // into single superinstructions. Only the first instruction of a fused
+    // sequence may be a jump target. Must run after every other pass.
+    void fuseSuperinstructions(BytecodeProgram& program) {
+        static const std::vector<std::pair<BytecodeOp, std::vector<BytecodeOp>>> patterns = {
+            {LOAD_VAR_CONST_BINARY_STORE, {LOAD_VAR, LOAD_CONST, BINARY_OP, STORE_VAR}},
+            {LOAD_VAR_CONST_BINARY_JUMP, {LOAD_VAR, LOAD_CONST, BINARY_OP, JUMP_IF_FALSE}},
+            {LOAD_VAR_CONST_BINARY, {LOAD_VAR, LOAD_CONST, BINARY_OP}},
+            {LOAD_VAR_VAR_BINARY, {LOAD_VAR, LOAD_VAR, BINARY_OP}},
+            {LOAD_VAR_VAR_SUBSCRIPT, {LOAD_VAR, LOAD_VAR, LOAD_SUBSCRIPT}},
+            {BINARY_OP_STORE, {BINARY_OP, STORE_VAR}},
+            {BINARY_OP_JUMP_IF_FALSE, {BINARY_OP, JUMP_IF_FALSE}},
+        };
+
+        std::vector<bool> targets = jumpTargets(program);
+        std::vector<bool> keep(program.size(), true);
+
+        for (size_t i = 0; i < program.size(); i++) {
+            for (const auto& pattern : patterns) {
+                const std::vector<BytecodeOp>& ops = pattern.second;
+                if (i + ops.size() > program.size()) continue;
+
+                bool matched = true;
+                for (size_t k = 0; k < ops.size() && matched; k++) {
+                    BytecodeOp op = program[i + k].op;
+                    if (op == STORE_VAR_KEEP) op = STORE_VAR;
+                    matched = op == ops[k] && (k == 0 || !targets[i + k]);
+                }
+                if (!matched) continue;
+
+                FusedOperand fused;
+                for (size_t k = 0; k < ops.size(); k++) {
+                    fused.parts.push_back(program[i + k]);
+                    if (k > 0) keep[i + k] = false;
+                }
+                program[i] = {pattern.first, fused};
+                i += ops.size() - 1;
+                break;
+            }
+        }
+
+        compact(program, keep);
+    }
+};
+
+#endif
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "utils/core.hpp"
 
 bool flag = false;
+int optimizeLevel = 2;
 std::string filename;
 std::vector<Token> tokens;
 std::vector<Statement*> statements;
@@ -10,62 +11,7 @@ std::map<std::string, ClassDeclaration*> classes;
 std::map<std::string, Value> consts;
 
 void printBytecode(const Bytecode& bytecode) {
-    switch (bytecode.op) {
-        case LOAD_CONST:
-            std::cout << "LOAD_CONST";
-            break;
-        case LOAD_VAR:
-            std::cout << "LOAD_VAR";
-            break;
-        case STORE_VAR:
-            std::cout << "STORE_VAR";
-            break;
-        case BINARY_OP:
-            std::cout << "BINARY_OP";
-            break;
-        case JUMP_IF_FALSE:
-            std::cout << "JUMP_IF_FALSE";
-            break;
-        case CALL_FUNCTION:
-            std::cout << "CALL_FUNCTION";
-            break;
-        case JUMP:
-            std::cout << "JUMP";
-            break;
-        case RETURN:
-            std::cout << "RETURN";
-            break;
-        case BUILD_LIST:
-            std::cout << "BUILD_LIST";
-            break;
-        case POP:
-            std::cout << "POP";
-            break;
-        case LOAD_SUBSCRIPT:
-            std::cout << "LOAD_SUBSCRIPT";
-            break;
-        case STORE_SUBSCRIPT:
-            std::cout << "STORE_SUBSCRIPT";
-            break;
-        case CREATE_OBJECT:
-            std::cout << "CREATE_OBJECT";
-            break;
-        case LOAD_MEMBER:
-            std::cout << "LOAD_MEMBER";
-            break;
-        case STORE_MEMBER:
-            std::cout << "STORE_MEMBER";
-            break;
-        // case CLEAR:
-        //     std::cout << "CLEAR";
-        //     break;
-        case LABEL:
-            std::cout << "LABEL";
-            break;
-        default:
-            std::cout << "Unknown opcode";
-            break;
-    }
+    std::cout << opcodeName(bytecode.op);
     
     Bytecode instr = bytecode;
     try{
@@ -104,11 +50,19 @@ void interpreters() {
         classes = codegen.getClasses();
         consts = codegen.getConstants();
 
+        Optimizer optimizer(optimizeLevel);
+        Assembler assembler;
+        optimizer.optimize(mainProgram);
+        for (auto& func : functions) {
+            optimizer.optimize(func.second->bytecode);
+            func.second->compiled = assembler.assemble(func.second->bytecode);
+        }
+
         if (globalVM.frames.empty()) {
-            globalVM.frames.push(VM::Frame(mainProgram));
+            globalVM.frames.push(VM::Frame(assembler.assemble(mainProgram)));
         } else {
             VM::Frame& globalFrame = globalVM.frames.top();
-            globalFrame.program = mainProgram;
+            globalFrame.program = assembler.assemble(mainProgram);
             globalFrame.pc = 0;
         }
         std::stack<Value>().swap(globalVM.operandStack);
@@ -167,6 +121,10 @@ signed main(int argc, char *argv[]) {
                 printf("VLine Compiler %s (publish on %s) [%s]\n", VLINE_VERSION, VLINE_PUBLISH, VLINE_COMPILER);
                 exit(0);
             }
+            if (argv[i][0] == '-' && argv[i][1] == 'O') {
+                optimizeLevel = std::atoi(argv[i] + 2);
+                continue;
+            }
             if (argv[i][0] == '-' && argv[i][1] == '-') {
                 std::string op = std::string(argv[i]).substr(2);
                 if (op == "version") {
@@ -181,6 +139,9 @@ signed main(int argc, char *argv[]) {
                         used[i + 1] = true;
                     }
                 }
+                if (op == "opstats") {
+                    globalVM.collectOpStats = true;
+                }
                 if (op == "in") {
                     if (i + 1 >= argc) throw std::runtime_error("Can't open file (empty filename)");
                     else {
@@ -263,5 +224,9 @@ signed main(int argc, char *argv[]) {
         inputFile.close();
     }
 
+    if (globalVM.collectOpStats) {
+        globalVM.dumpOpStats(std::cerr);
+    }
+
     return 0;
 }
\ No newline at end of file
@@ -369,10 +369,11 @@ private:
 
     Expression* comparison_expression() {
         Expression* left = arithmetic_expression();
-        while (peek().type == TOKEN_OPERATOR &&
-               (peek().value == "<" || peek().value == "<=" ||
-                peek().value == ">" || peek().value == ">=" ||
-                peek().value == "==" || peek().value == "!=")) {
+        while ((peek().type == TOKEN_OPERATOR &&
+                (peek().value == "<" || peek().value == "<=" ||
+                 peek().value == ">" || peek().value == ">=" ||
+                 peek().value == "==" || peek().value == "!=")) ||
+               (peek().type == TOKEN_KEYWORD && peek().value == "in")) {
             Token op = peek();
             consume();
             Expression* right = arithmetic_expression();
@@ -423,7 +424,48 @@ private:
         }
     }
 
+    // Rest of "target[start:end]" from the ':' on; the end may be left out.
+    SliceExpression* slice(Expression* target, Expression* start) {
+        consume();
+        Expression* end = nullptr;
+        if (peek().type != TOKEN_PUNCTUATION || peek().value != "]") {
+            end = expression();
+        }
+        if (peek().type != TOKEN_PUNCTUATION || peek().value != "]") {
+            throwSyntaxError("Expected ']' after slice");
+        }
+        consume();
+        return new SliceExpression(target, start, end);
+    }
+
+    // "target[index]" or "target[start:end]" from the '[' on.
+    Expression* subscript(Expression* target) {
+        consume();
+        Expression* index = nullptr;
+        if (peek().type != TOKEN_PUNCTUATION || peek().value != ":") {
+            index = expression();
+        }
+        if (peek().type == TOKEN_PUNCTUATION && peek().value == ":") {
+            return slice(target, index);
+        }
+        if (peek().type != TOKEN_PUNCTUATION || peek().value != "]") {
+            throwSyntaxError("Expected ']' after list index");
+        }
+        consume();
+        return new BinaryExpression("[]", target, index);
+    }
+
+    // Any primary may be followed by subscripts and slices: f(x)[0],
+    // [1, 2, 3][0:2], xs[a:b][c:d].
     Expression* primary() {
+        Expression* expr = atom();
+        while (peek().type == TOKEN_PUNCTUATION && peek().value == "[") {
+            expr = subscript(expr);
+        }
+        return expr;
+    }
+
+    Expression* atom() {
         Token token = peek();
         if (token.type == TOKEN_NUMBER) {
             consume();
@@ -483,7 +525,13 @@ private:
                 objects.push_back(new Identifier(member.value));
                 if (peek().type == TOKEN_PUNCTUATION && peek().value == "[") {
                     consume();
-                    Expression* index = expression();
+                    Expression* index = nullptr;
+                    if (peek().type != TOKEN_PUNCTUATION || peek().value != ":") {
+                        index = expression();
+                    }
+                    if (peek().type == TOKEN_PUNCTUATION && peek().value == ":") {
+                        return slice(new MemberAccess(objects), index);
+                    }
                     if (peek().type != TOKEN_PUNCTUATION || peek().value != "]") {
                         throwSyntaxError("Expected ']' after list index");
                     }
@@ -508,14 +556,6 @@ private:
                 }
                 consume();
                 return new FunctionCall(token.value, args);
-            } else if (peek().type == TOKEN_PUNCTUATION && peek().value == "[") {
-                consume();
-                Expression* index = expression();
-                if (peek().type != TOKEN_PUNCTUATION || peek().value != "]") {
-                    throwSyntaxError("Expected ']' after list index");
-                }
-                consume();
-                return new BinaryExpression("[]", new Identifier(token.value), index);
             } else {
                 return new Identifier(token.value);
             }
@@ -541,6 +581,29 @@ private:
             }
             consume();
             return new ListLiteral(elements);
+        } else if (token.type == TOKEN_PUNCTUATION && token.value == "{") {
+            consume();
+            std::vector<Expression*> keys;
+            std::vector<Expression*> values;
+            if (peek().type != TOKEN_PUNCTUATION || peek().value != "}") {
+                while (true) {
+                    keys.push_back(expression());
+                    if (peek().type != TOKEN_PUNCTUATION || peek().value != ":") {
+                        throwSyntaxError("Expected ':' after dict key");
+                    }
+                    consume();
+                    values.push_back(expression());
+                    if (peek().type == TOKEN_PUNCTUATION && peek().value == "}") {
+                        break;
+                    } else if (peek().type == TOKEN_PUNCTUATION && peek().value == ",") {
+                        consume();
+                    } else {
+                        throwSyntaxError("Expected ',' or '}' in dict literal");
+                    }
+                }
+            }
+            consume();
+            return new DictLiteral(keys, values);
         } else if (token.type == TOKEN_KEYWORD && token.value == "new") {
             consume();
             Token className = peek();
@@ -5,22 +5,257 @@
 #include <string>
 #include <stdexcept>
 #include <map>
+#include <memory>
+#include <type_traits>
 #include "../vm/bignum.hpp"
 #include "../ast/ast.hpp"
 
+class Dict;
+class NumArray;
+struct Value;
+
+// Elements of a Value::LIST. Copies of a list share one buffer, and a slice
+// is a window (offset, length) into the buffer it was taken from, so both
+// are O(1). Every write goes through detach(), which first gives the list
+// a buffer of its own if the current one is shared or only partly visible.
+//
+// A list also tracks the kind of its elements. SMALL_INT lists (integers
+// that fit in an int64_t) keep them packed as int64_t instead of as full
+// Values; the other kinds hold Values. Storing an element that does not fit
+// widens the kind, and a list never narrows again while it has elements.
+class List {
+public:
+    enum Kind { SMALL_INT, NUMBER, STRING, GENERIC };
+
+    List() = default;
+    explicit List(std::vector<Value> values);
+    explicit List(std::vector<int64_t> values);
+
+    Kind kind() const;
+    size_t size() const { return length; }
+    bool empty() const { return length == 0; }
+    Value at(size_t index) const;
+    // Packed elements of a SMALL_INT list.
+    const int64_t* ints() const;
+
+    // True if f(element) holds for some element; stops at the first one.
+    template<typename F>
+    bool any(F&& f) const;
+    template<typename F>
+    void forEach(F&& f) const;
+
+    // Elements [start, end), sharing this list's buffer.
+    List slice(size_t start, size_t end) const;
+
+    void set(size_t index, Value value);
+    void push_back(Value value);
+    void insert(size_t index, Value value);
+    void erase(size_t start, size_t end);
+
+private:
+    struct Buffer;
+
+    std::shared_ptr<Buffer> buffer;
+    size_t offset = 0;
+    size_t length = 0;
+
+    static Kind kindOf(const Value& value, int64_t& small);
+    static Kind widen(Kind a, Kind b);
+    Buffer& detach();
+    Buffer& prepareStore(const Value& value, int64_t& small);
+};
+
 struct Value {
-    enum ValueType { NUMBER, STRING, LIST, NULL_TYPE, OBJECT };
+    enum ValueType { NUMBER, STRING, LIST, NULL_TYPE, OBJECT, FLOAT, DICT, SET, ARRAY };
     ValueType type;
     std::string strValue;
-    std::vector<Value> listValue;
+    List listValue;
     BigNum bignumValue;
+    double floatValue = 0;
     std::map<std::string, Value> objectMembers;
     std::map<std::string, FunctionDeclaration*> functions;
+    // Table of a DICT or SET, shared by copies of the Value; written
+    // through mutableDict() (vm/dict.hpp).
+    std::shared_ptr<Dict> dictValue;
+    // Elements of an ARRAY, shared likewise; written through
+    // mutableArray() (vm/array.hpp).
+    std::shared_ptr<NumArray> arrayValue;
 
     Value() : type(NULL_TYPE) {}
     explicit Value(const BigNum& val) : type(NUMBER), bignumValue(val) {}
+    explicit Value(double val) : type(FLOAT), floatValue(val) {}
+    // Integers must be wrapped in a BigNum; without this they would
+    // silently become floats through Value(double).
+    template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    explicit Value(T) = delete;
     explicit Value(const std::string& val) : type(STRING), strValue(val) {}
-    explicit Value(const std::vector<Value>& val) : type(LIST), listValue(val) {}
+    explicit Value(std::vector<Value> val) : type(LIST), listValue(std::move(val)) {}
+    explicit Value(List val) : type(LIST), listValue(std::move(val)) {}
+    explicit Value(std::shared_ptr<Dict> val) : type(DICT), dictValue(std::move(val)) {}
+    explicit Value(std::shared_ptr<NumArray> val) : type(ARRAY), arrayValue(std::move(val)) {}
 };
 
+// The kind is kept with the elements rather than in List, so that a List
+// (and with it every Value) stays small.
+struct List::Buffer {
+    Kind kind = SMALL_INT;
+    std::vector<int64_t> ints;      // SMALL_INT elements
+    std::vector<Value> values;      // elements of the other kinds
+};
+
+inline List::Kind List::kindOf(const Value& value, int64_t& small) {
+    if (value.type == Value::NUMBER) return value.bignumValue.fits_int64(small) ? SMALL_INT : NUMBER;
+    if (value.type == Value::STRING) return STRING;
+    return GENERIC;
+}
+
+inline List::Kind List::widen(Kind a, Kind b) {
+    if (a == b) return a;
+    bool numbers = (a == SMALL_INT || a == NUMBER) && (b == SMALL_INT || b == NUMBER);
+    return numbers ? NUMBER : GENERIC;
+}
+
+inline List::List(std::vector<Value> values) : buffer(std::make_shared<Buffer>()), length(values.size()) {
+    int64_t small;
+    Kind& elementKind = buffer->kind;
+    for (size_t i = 0; i < values.size() && elementKind != GENERIC; i++) {
+        Kind kind = kindOf(values[i], small);
+        elementKind = i == 0 ? kind : widen(elementKind, kind);
+    }
+    if (elementKind == SMALL_INT) {
+        buffer->ints.reserve(length);
+        for (const Value& value : values) {
+            value.bignumValue.fits_int64(small);
+            buffer->ints.push_back(small);
+        }
+    } else {
+        buffer->values = std::move(values);
+    }
+}
+
+inline List::List(std::vector<int64_t> values)
+        : buffer(std::make_shared<Buffer>(Buffer{SMALL_INT, std::move(values), {}})), length(buffer->ints.size()) {}
+
+inline List::Kind List::kind() const {
+    return buffer ? buffer->kind : SMALL_INT;
+}
+
+inline Value List::at(size_t index) const {
+    if (buffer->kind == SMALL_INT) return Value(BigNum((long long)buffer->ints[offset + index]));
+    return buffer->values[offset + index];
+}
+
+inline const int64_t* List::ints() const {
+    return buffer ? buffer->ints.data() + offset : nullptr;
+}
+
+template<typename F>
+bool List::any(F&& f) const {
+    bool packed = kind() == SMALL_INT;
+    for (size_t i = 0; i < length; i++) {
+        if (packed ? f(Value(BigNum((long long)buffer->ints[offset + i]))) : f(buffer->values[offset + i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template<typename F>
+void List::forEach(F&& f) const {
+    any([&](const Value& value) { f(value); return false; });
+}
+
+inline List List::slice(size_t start, size_t end) const {
+    List result = *this;
+    result.offset = offset + start;
+    result.length = end - start;
+    return result;
+}
+
+inline List::Buffer& List::detach() {
+    if (!buffer) {
+        buffer = std::make_shared<Buffer>();
+    } else if (buffer.use_count() > 1) {
+        auto copy = std::make_shared<Buffer>();
+        copy->kind = buffer->kind;
+        if (copy->kind == SMALL_INT) {
+            copy->ints.assign(buffer->ints.begin() + offset, buffer->ints.begin() + offset + length);
+        } else {
+            copy->values.assign(buffer->values.begin() + offset, buffer->values.begin() + offset + length);
+        }
+        buffer = std::move(copy);
+    } else if (offset != 0 || length != (buffer->kind == SMALL_INT ? buffer->ints.size() : buffer->values.size())) {
+        auto trim = [&](auto& items) {
+            items.erase(items.begin() + offset + length, items.end());
+            items.erase(items.begin(), items.begin() + offset);
+        };
+        if (buffer->kind == SMALL_INT) trim(buffer->ints); else trim(buffer->values);
+    }
+    offset = 0;
+    return *buffer;
+}
+
+// Detaches the buffer and widens the kind so that value can be stored;
+// small receives value as an int64_t when the list stays SMALL_INT.
+inline List::Buffer& List::prepareStore(const Value& value, int64_t& small) {
+    Kind kind = kindOf(value, small);
+    Buffer& items = detach();
+    if (length == 0) {
+        items.ints.clear();
+        items.values.clear();
+        items.kind = kind;
+    } else if (kind != items.kind) {
+        Kind widened = widen(items.kind, kind);
+        if (items.kind == SMALL_INT) {
+            items.values.reserve(items.ints.size() + 1);
+            for (int64_t x : items.ints) items.values.emplace_back(BigNum((long long)x));
+            std::vector<int64_t>().swap(items.ints);
+        }
+        items.kind = widened;
+    }
+    return items;
+}
+
+inline void List::set(size_t index, Value value) {
+    int64_t small;
+    Buffer& items = prepareStore(value, small);
+    if (items.kind == SMALL_INT) {
+        items.ints[index] = small;
+    } else {
+        items.values[index] = std::move(value);
+    }
+}
+
+inline void List::push_back(Value value) {
+    int64_t small;
+    Buffer& items = prepareStore(value, small);
+    if (items.kind == SMALL_INT) {
+        items.ints.push_back(small);
+    } else {
+        items.values.push_back(std::move(value));
+    }
+    length++;
+}
+
+inline void List::insert(size_t index, Value value) {
+    int64_t small;
+    Buffer& items = prepareStore(value, small);
+    if (items.kind == SMALL_INT) {
+        items.ints.insert(items.ints.begin() + index, small);
+    } else {
+        items.values.insert(items.values.begin() + index, std::move(value));
+    }
+    length++;
+}
+
+inline void List::erase(size_t start, size_t end) {
+    Buffer& items = detach();
+    if (items.kind == SMALL_INT) {
+        items.ints.erase(items.ints.begin() + start, items.ints.begin() + end);
+    } else {
+        items.values.erase(items.values.begin() + start, items.values.begin() + end);
+    }
+    length -= end - start;
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,129 @@
+#ifndef STD_ARRAYS_HPP
+#define STD_ARRAYS_HPP
+
+#include "../../utils/core.hpp"
+#include "../../vm/array.hpp"
+
+Value makeTypedArray(const std::string& func, NumArray::Kind kind, const std::vector<Value>& args) {
+    checkArgCount(func, 1, args);
+    auto array = std::make_shared<NumArray>(kind);
+    if (args[0].type == Value::ARRAY) {
+        const NumArray& source = *args[0].arrayValue;
+        if (source.kind == kind) return args[0];
+        if (kind == NumArray::FLOAT64) {
+            array->floats.assign(source.ints.begin(), source.ints.end());
+        } else {
+            array->ints.reserve(source.size());
+            for (double value : source.floats) {
+                if (value != std::trunc(value) || std::fabs(value) >= 0x1p63) {
+                    throwTypeError("int64 elements must be integers in the int64 range");
+                }
+                array->ints.push_back((int64_t)value);
+            }
+        }
+    } else if (args[0].type == Value::LIST) {
+        const List& items = args[0].listValue;
+        if (items.kind() == List::SMALL_INT) {
+            if (kind == NumArray::INT64) {
+                array->ints.assign(items.ints(), items.ints() + items.size());
+            } else {
+                array->floats.assign(items.ints(), items.ints() + items.size());
+            }
+        } else if (kind == NumArray::INT64) {
+            array->ints.reserve(items.size());
+            items.forEach([&](const Value& item) { array->ints.push_back(toInt64(item)); });
+        } else {
+            array->floats.reserve(items.size());
+            items.forEach([&](const Value& item) { array->floats.push_back(toFloat64(item)); });
+        }
+    } else {
+        throwTypeError(func + "() expects a list or an array");
+    }
+    return Value(array);
+}
+
+Value builtinInt64(const std::vector<Value>& args) {
+    return makeTypedArray("int64", NumArray::INT64, args);
+}
+
+Value builtinFloat64(const std::vector<Value>& args) {
+    return makeTypedArray("float64", NumArray::FLOAT64, args);
+}
+
+const NumArray& checkArray(const std::string& func, const Value& value) {
+    if (value.type != Value::ARRAY) {
+        throwTypeError(func + "() expects an array");
+    }
+    return *value.arrayValue;
+}
+
+Value arraySum(const std::vector<Value>& args) {
+    checkArgCount("sum", 1, args);
+    const NumArray& array = checkArray("sum", args[0]);
+    if (array.kind == NumArray::INT64) {
+        return Value(BigNum((long long)array_kernels::i64_sum(array.ints.data(), array.size())));
+    }
+    return Value(array_kernels::f64_sum(array.floats.data(), array.size()));
+}
+
+Value arrayDot(const std::vector<Value>& args) {
+    checkArgCount("dot", 2, args);
+    const NumArray& a = checkArray("dot", args[0]);
+    const NumArray& b = checkArray("dot", args[1]);
+    if (a.size() != b.size()) {
+        throwRuntimeError("dot() expects arrays of the same length");
+    }
+    if (a.kind == NumArray::INT64 && b.kind == NumArray::INT64) {
+        return Value(BigNum((long long)array_kernels::i64_dot(a.ints.data(), b.ints.data(), a.size())));
+    }
+    std::vector<double> storageA, storageB;
+    return Value(array_kernels::f64_dot(a.asFloats(storageA), b.asFloats(storageB), a.size()));
+}
+
+template<bool MAX>
+Value arrayExtreme(const std::string& func, const std::vector<Value>& args) {
+    checkArgCount(func, 1, args);
+    const NumArray& array = checkArray(func, args[0]);
+    if (array.size() == 0) {
+        throwRuntimeError(func + "() of an empty array");
+    }
+    if (array.kind == NumArray::INT64) {
+        return Value(BigNum((long long)array_kernels::i64_extreme<MAX>(array.ints.data(), array.size())));
+    }
+    return Value(array_kernels::f64_extreme<MAX>(array.floats.data(), array.size()));
+}
+
+Value arrayMin(const std::vector<Value>& args) {
+    return arrayExtreme<false>("min", args);
+}
+
+Value arrayMax(const std::vector<Value>& args) {
+    return arrayExtreme<true>("max", args);
+}
+
+// scale(a, k) is a * k, but like the container builtins it takes the array
+// by value and, after `a = scale(a, k)`, multiplies its buffer in place.
+Value arrayScale(std::vector<Value>& args) {
+    checkArgCount("scale", 2, args);
+    checkArray("scale", args[0]);
+    if (args[1].type != Value::NUMBER && args[1].type != Value::FLOAT) {
+        throwTypeError("scale() expects a number as factor");
+    }
+
+    ArrayOperand factor(args[1]);
+    if (args[0].arrayValue->kind == NumArray::INT64 && factor.isFloat) {
+        return arrayBinaryOp(args[0], args[1], OP_MUL);
+    }
+    Value arrayCopy = std::move(args[0]);
+    NumArray& array = mutableArray(arrayCopy);
+    if (array.kind == NumArray::INT64) {
+        int64_t* data = array.ints.data();
+        array_kernels::i64_arith(array_kernels::MUL, data, data, 1, factor.ints(), 0, array.size());
+    } else {
+        double* data = array.floats.data();
+        array_kernels::f64_arith(array_kernels::MUL, data, data, 1, factor.floats(), 0, array.size());
+    }
+    return arrayCopy;
+}
+
+#endif
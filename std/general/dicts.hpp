@@ -0,0 +1,43 @@
+#ifndef STD_DICTS_HPP
+#define STD_DICTS_HPP
+
+#include "../../utils/core.hpp"
+
+Value dictKeys(const std::vector<Value>& args) {
+    checkArgCount("keys", 1, args);
+    if (args[0].type != Value::DICT) {
+        throwTypeError("keys() expects a dict");
+    }
+
+    std::vector<Value> keys;
+    keys.reserve(args[0].dictValue->size());
+    args[0].dictValue->forEachKey([&](const Value& key) { keys.push_back(key); });
+    return Value(keys);
+}
+
+Value dictValues(const std::vector<Value>& args) {
+    checkArgCount("values", 1, args);
+    if (args[0].type != Value::DICT) {
+        throwTypeError("values() expects a dict");
+    }
+
+    std::vector<Value> values;
+    values.reserve(args[0].dictValue->size());
+    args[0].dictValue->forEach([&](const Value&, const Value& value) { values.push_back(value); });
+    return Value(values);
+}
+
+Value dictRemove(std::vector<Value>& args) {
+    checkArgCount("remove", 2, args);
+    if (args[0].type != Value::DICT) {
+        throwTypeError("remove() expects a dict");
+    }
+
+    // A failed erase leaves the dict as it was.
+    if (!mutableDict(args[0]).erase(args[1])) {
+        throwIndexError("remove() key not found in dict");
+    }
+    return std::move(args[0]);
+}
+
+#endif
@@ -9,6 +9,15 @@ Value builtinRange(const std::vector<Value>& args) {
         throwTypeError("range() expects number");
     }
 
+    // Integer bounds give a packed SMALL_INT list without going through Values.
+    int64_t first, last;
+    if (args[0].bignumValue.fits_int64(first) && args[1].bignumValue.fits_int64(last)) {
+        std::vector<int64_t> ints;
+        if (first < last) ints.reserve((uint64_t)last - (uint64_t)first);
+        for (int64_t i = first; i < last; i++) ints.push_back(i);
+        return Value(List(std::move(ints)));
+    }
+
     std::vector<Value> list;
     BigNum start = args[0].bignumValue;
     BigNum end = args[1].bignumValue;
@@ -21,26 +30,37 @@ Value builtinRange(const std::vector<Value>& args) {
 Value builtinLen(const std::vector<Value>& args) {
     checkArgCount("len", 1, args);
     if (args[0].type == Value::STRING) {
-        return Value(args[0].strValue.size());
+        return Value(BigNum(args[0].strValue.size()));
     }
     if (args[0].type == Value::LIST) {
-        return Value(args[0].listValue.size());
+        return Value(BigNum(args[0].listValue.size()));
+    }
+    if (args[0].type == Value::DICT || args[0].type == Value::SET) {
+        return Value(BigNum(args[0].dictValue->size()));
+    }
+    if (args[0].type == Value::ARRAY) {
+        return Value(BigNum(args[0].arrayValue->size()));
     }
-    throwTypeError("len() expects string or list");
+    throwTypeError("len() expects string, list, dict, set or array");
 }
 
-Value listAppend(const std::vector<Value>& args) {
+// The container builtins take their arguments by reference and move the
+// container out of args[0]: after `xs = append(xs, v)` releases xs (see
+// VM::callInPlace) they own the only copy and update it in place. They
+// must not touch args[0] before they can no longer fail, since on an
+// error args[0] is stored back into xs.
+Value listAppend(std::vector<Value>& args) {
     checkArgCount("list.append", 2, args);
     if (args[0].type != Value::LIST) {
         throwTypeError("list.append() expects a list");
     }
 
-    Value listCopy = args[0];
-    listCopy.listValue.push_back(args[1]);
+    Value listCopy = std::move(args[0]);
+    listCopy.listValue.push_back(std::move(args[1]));
     return listCopy;
 }
 
-Value listInsert(const std::vector<Value>& args) {
+Value listInsert(std::vector<Value>& args) {
     checkArgCount("list.insert", 3, args);
     if (args[0].type!= Value::LIST) {
         throwTypeError("list.insert() expects a list");
@@ -48,17 +68,16 @@ Value listInsert(const std::vector<Value>& args) {
     if (args[1].type!= Value::NUMBER || args[2].type!= Value::NUMBER) {
         throwTypeError("list.insert() expects two numbers");
     }
-    Value listCopy = args[0];
     BigNum index = args[1].bignumValue;
-    const Value& value = args[2];
-    if (index < 0 || index > listCopy.listValue.size()) {
+    if (index < 0 || index > args[0].listValue.size()) {
         throwIndexError("list.insert() index out of range");
     }
-    listCopy.listValue.insert(listCopy.listValue.begin() + index.get_ll(), value);
+    Value listCopy = std::move(args[0]);
+    listCopy.listValue.insert(index.get_ll(), args[2]);
     return listCopy;
 }
 
-Value listErase(const std::vector<Value>& args) {
+Value listErase(std::vector<Value>& args) {
     checkArgCount("list.erase", 3, args);
     if (args[0].type!= Value::LIST) {
         throwTypeError("list.erase() expects a list");
@@ -66,14 +85,93 @@ Value listErase(const std::vector<Value>& args) {
     if (args[1].type != Value::NUMBER || args[2].type != Value::NUMBER) {
         throwTypeError("list.erase() expects two numbers");
     }
-    Value listCopy = args[0];
     BigNum start = args[1].bignumValue;
     BigNum end = args[2].bignumValue;
-    if (start < 0 || start >= listCopy.listValue.size() || end < 0 || end > listCopy.listValue.size()) {
+    size_t size = args[0].listValue.size();
+    if (start < 0 || start >= size || end > size) {
         throwIndexError("list.erase() index out of range");
     }
-    listCopy.listValue.erase(listCopy.listValue.begin() + start.get_ll(), listCopy.listValue.begin() + end.get_ll());
+    if (end < start) {
+        throwIndexError("list.erase() end is before start");
+    }
+    Value listCopy = std::move(args[0]);
+    listCopy.listValue.erase(start.get_ll(), end.get_ll());
     return listCopy;
 }
 
+Value makeSet(std::shared_ptr<Dict> table) {
+    Value set(std::move(table));
+    set.type = Value::SET;
+    return set;
+}
+
+Value builtinSet(const std::vector<Value>& args) {
+    checkArgCount("set", 1, args);
+    if (args[0].type == Value::SET) {
+        return args[0];
+    }
+    if (args[0].type != Value::LIST) {
+        throwTypeError("set() expects a list or set");
+    }
+
+    auto table = std::make_shared<Dict>();
+    args[0].listValue.forEach([&](const Value& item) { table->add(item); });
+    return makeSet(table);
+}
+
+Value setInsert(std::vector<Value>& args) {
+    checkArgCount("set.insert", 2, args);
+    // An unhashable element is rejected before the set changes.
+    mutableDict(args[0]).add(args[1]);
+    return std::move(args[0]);
+}
+
+Value setRemove(std::vector<Value>& args) {
+    checkArgCount("set.remove", 2, args);
+    // A failed erase leaves the set as it was.
+    if (!mutableDict(args[0]).erase(args[1])) {
+        throwIndexError("set.remove() element not found");
+    }
+    return std::move(args[0]);
+}
+
+void checkSetArgs(const std::string& func, const std::vector<Value>& args) {
+    checkArgCount(func, 2, args);
+    if (args[0].type != Value::SET || args[1].type != Value::SET) {
+        throwTypeError(func + "() expects two sets");
+    }
+}
+
+// union and difference start from the first set, so `a = union(a, b)`
+// only touches the elements of b.
+Value setUnion(std::vector<Value>& args) {
+    checkSetArgs("union", args);
+    Value result = std::move(args[0]);
+    Dict& table = mutableDict(result);
+    args[1].dictValue->forEachKey([&](const Value& key) { table.add(key); });
+    return result;
+}
+
+Value setIntersection(const std::vector<Value>& args) {
+    checkSetArgs("intersection", args);
+    const Dict& a = *args[0].dictValue;
+    const Dict& b = *args[1].dictValue;
+    const Dict& smaller = a.size() <= b.size() ? a : b;
+    const Dict& larger = a.size() <= b.size() ? b : a;
+    auto table = std::make_shared<Dict>();
+    smaller.forEachKey([&](const Value& key) {
+        if (larger.contains(key)) table->add(key);
+    });
+    return makeSet(table);
+}
+
+Value setDifference(std::vector<Value>& args) {
+    checkSetArgs("difference", args);
+    Value result = std::move(args[0]);
+    if (args[1].dictValue->size() == 0) return result;
+    Dict& table = mutableDict(result);
+    args[1].dictValue->forEachKey([&](const Value& key) { table.erase(key); });
+    return result;
+}
+
 #endif
\ No newline at end of file
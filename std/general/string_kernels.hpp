@@ -0,0 +1,114 @@
+#ifndef STRING_KERNELS_HPP
+#define STRING_KERNELS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define STRING_KERNELS_X86 1
+#endif
+
+// Substring search for the string builtins. Single bytes go to memchr.
+// Longer needles use the SIMD first/last byte filter: every position of a
+// 16 (SSE2) or 32 (AVX2) byte block is compared against the first and the
+// last byte of the needle at once, and only positions matching both are
+// checked with memcmp. Needles past LONG_NEEDLE go to glibc's memmem
+// (two-way), which stays linear on inputs that defeat the filter.
+namespace string_kernels {
+
+const size_t npos = std::string::npos;
+const size_t LONG_NEEDLE = 64;
+
+inline size_t find_scalar(const char* h, size_t n, const char* needle, size_t m, size_t from) {
+    const char first = needle[0];
+    while (from + m <= n) {
+        const void* hit = memchr(h + from, first, n - m + 1 - from);
+        if (hit == nullptr) return npos;
+        size_t i = (const char*)hit - h;
+        if (memcmp(h + i + 1, needle + 1, m - 1) == 0) return i;
+        from = i + 1;
+    }
+    return npos;
+}
+
+#ifdef STRING_KERNELS_X86
+
+__attribute__((target("sse2")))
+inline size_t find_sse2(const char* h, size_t n, const char* needle, size_t m, size_t from) {
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[m - 1]);
+    size_t i = from;
+    for (; i + m - 1 + 16 <= n; i += 16) {
+        __m128i block_first = _mm_loadu_si128((const __m128i*)(h + i));
+        __m128i block_last = _mm_loadu_si128((const __m128i*)(h + i + m - 1));
+        uint32_t mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, block_first),
+                                                        _mm_cmpeq_epi8(last, block_last)));
+        while (mask != 0) {
+            size_t pos = i + __builtin_ctz(mask);
+            if (memcmp(h + pos + 1, needle + 1, m - 2) == 0) return pos;
+            mask &= mask - 1;
+        }
+    }
+    return find_scalar(h, n, needle, m, i);
+}
+
+__attribute__((target("avx2")))
+inline size_t find_avx2(const char* h, size_t n, const char* needle, size_t m, size_t from) {
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[m - 1]);
+    size_t i = from;
+    for (; i + m - 1 + 32 <= n; i += 32) {
+        __m256i block_first = _mm256_loadu_si256((const __m256i*)(h + i));
+        __m256i block_last = _mm256_loadu_si256((const __m256i*)(h + i + m - 1));
+        uint32_t mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, block_first),
+                                                              _mm256_cmpeq_epi8(last, block_last)));
+        while (mask != 0) {
+            size_t pos = i + __builtin_ctz(mask);
+            if (memcmp(h + pos + 1, needle + 1, m - 2) == 0) return pos;
+            mask &= mask - 1;
+        }
+    }
+    return find_scalar(h, n, needle, m, i);
+}
+
+#endif
+
+typedef size_t (*find_kernel)(const char*, size_t, const char*, size_t, size_t);
+
+inline find_kernel best_find() {
+    static const find_kernel kernel = [] {
+#ifdef STRING_KERNELS_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return (find_kernel)find_avx2;
+        if (__builtin_cpu_supports("sse2")) return (find_kernel)find_sse2;
+#endif
+        return (find_kernel)find_scalar;
+    }();
+    return kernel;
+}
+
+// Offset of the first occurrence of needle[0..m) in h[from..n), or npos.
+inline size_t find(const char* h, size_t n, const char* needle, size_t m, size_t from = 0) {
+    if (from > n || m > n - from) return npos;
+    if (m == 0) return from;
+    if (m == 1) {
+        const void* hit = memchr(h + from, needle[0], n - from);
+        return hit == nullptr ? npos : (const char*)hit - h;
+    }
+    if (m > LONG_NEEDLE) {
+        const void* hit = memmem(h + from, n - from, needle, m);
+        return hit == nullptr ? npos : (const char*)hit - h;
+    }
+    return best_find()(h, n, needle, m, from);
+}
+
+inline size_t find(const std::string& haystack, const std::string& needle, size_t from = 0) {
+    return find(haystack.data(), haystack.size(), needle.data(), needle.size(), from);
+}
+
+}
+
+#endif
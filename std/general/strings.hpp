@@ -0,0 +1,131 @@
+#ifndef STD_STRINGS_HPP
+#define STD_STRINGS_HPP
+
+#include "../../utils/core.hpp"
+#include "string_kernels.hpp"
+
+Value substringValue(const std::string& str, size_t pos, size_t len) {
+    Value result;
+    result.type = Value::STRING;
+    result.strValue.assign(str, pos, len);
+    return result;
+}
+
+void checkStringArgs(const std::string& func, const std::vector<Value>& args) {
+    for (const Value& arg : args) {
+        if (arg.type != Value::STRING) {
+            throwTypeError(func + "() expects strings");
+        }
+    }
+}
+
+// find(s, sub): offset of the first occurrence of sub in s, or -1.
+Value builtinFind(const std::vector<Value>& args) {
+    checkArgCount("find", 2, args);
+    checkStringArgs("find", args);
+    size_t pos = string_kernels::find(args[0].strValue, args[1].strValue);
+    return Value(pos == string_kernels::npos ? BigNum(-1) : BigNum(pos));
+}
+
+// split(s, sep) cuts at every sep and keeps empty pieces; split(s) cuts at
+// runs of whitespace and drops them.
+Value builtinSplit(const std::vector<Value>& args) {
+    if (args.size() != 1 && args.size() != 2) {
+        throwTypeError("split() expects 1 or 2 arguments");
+    }
+    checkStringArgs("split", args);
+    const std::string& str = args[0].strValue;
+    std::vector<Value> parts;
+
+    if (args.size() == 1) {
+        size_t i = 0;
+        while (true) {
+            while (i < str.size() && isspace((unsigned char)str[i])) i++;
+            if (i == str.size()) break;
+            size_t start = i;
+            while (i < str.size() && !isspace((unsigned char)str[i])) i++;
+            parts.push_back(substringValue(str, start, i - start));
+        }
+        return Value(parts);
+    }
+
+    const std::string& sep = args[1].strValue;
+    if (sep.empty()) {
+        throwRuntimeError("split() separator must not be empty");
+    }
+    size_t start = 0;
+    for (size_t pos; (pos = string_kernels::find(str, sep, start)) != string_kernels::npos; start = pos + sep.size()) {
+        parts.push_back(substringValue(str, start, pos - start));
+    }
+    parts.push_back(substringValue(str, start, str.size() - start));
+    return Value(parts);
+}
+
+// replace(s, old, new) replaces every occurrence; the matches are found
+// first so the result is allocated once.
+Value builtinReplace(const std::vector<Value>& args) {
+    checkArgCount("replace", 3, args);
+    checkStringArgs("replace", args);
+    const std::string& str = args[0].strValue;
+    const std::string& from = args[1].strValue;
+    const std::string& to = args[2].strValue;
+    if (from.empty()) {
+        throwRuntimeError("replace() pattern must not be empty");
+    }
+
+    std::vector<size_t> matches;
+    for (size_t pos = 0; (pos = string_kernels::find(str, from, pos)) != string_kernels::npos; pos += from.size()) {
+        matches.push_back(pos);
+    }
+    if (matches.empty()) return args[0];
+
+    Value result;
+    result.type = Value::STRING;
+    result.strValue.reserve(str.size() - matches.size() * from.size() + matches.size() * to.size());
+    size_t start = 0;
+    for (size_t pos : matches) {
+        result.strValue.append(str, start, pos - start);
+        result.strValue += to;
+        start = pos + from.size();
+    }
+    result.strValue.append(str, start, std::string::npos);
+    return result;
+}
+
+Value builtinStrip(const std::vector<Value>& args) {
+    checkArgCount("strip", 1, args);
+    checkStringArgs("strip", args);
+    const std::string& str = args[0].strValue;
+    size_t start = 0, end = str.size();
+    while (start < end && isspace((unsigned char)str[start])) start++;
+    while (end > start && isspace((unsigned char)str[end - 1])) end--;
+    return substringValue(str, start, end - start);
+}
+
+Value builtinJoin(const std::vector<Value>& args) {
+    checkArgCount("join", 2, args);
+    if (args[0].type != Value::LIST || args[1].type != Value::STRING) {
+        throwTypeError("join() expects a list of strings and a separator string");
+    }
+
+    const List& parts = args[0].listValue;
+    const std::string& sep = args[1].strValue;
+    // A list still tracked as STRING needs no per-element check.
+    if (parts.kind() != List::STRING && parts.any([](const Value& part) { return part.type != Value::STRING; })) {
+        throwTypeError("join() expects a list of strings");
+    }
+    size_t size = parts.empty() ? 0 : sep.size() * (parts.size() - 1);
+    parts.forEach([&](const Value& part) { size += part.strValue.size(); });
+
+    std::string result;
+    result.reserve(size);
+    bool first = true;
+    parts.forEach([&](const Value& part) {
+        if (!first) result += sep;
+        first = false;
+        result += part.strValue;
+    });
+    return Value(result);
+}
+
+#endif
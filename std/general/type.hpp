@@ -11,6 +11,10 @@ Value builtinType(const std::vector<Value>& args) {
         case Value::LIST: return Value("list");
         case Value::NULL_TYPE: return Value("null");
         case Value::OBJECT: return Value("object");
+        case Value::FLOAT: return Value("float");
+        case Value::DICT: return Value("dict");
+        case Value::SET: return Value("set");
+        case Value::ARRAY: return Value("array");
         default: return Value("unknown");
     }
 }
@@ -25,6 +29,12 @@ Value builtinNumber(const std::vector<Value>& args) {
         case Value::STRING: {
             return Value(BigNum(args[0].strValue));
         }
+        case Value::FLOAT: {
+            if (!std::isfinite(args[0].floatValue)) {
+                throwTypeError("Cannot convert inf or nan to number!");
+            }
+            return Value(BigNum(args[0].floatValue));
+        }
         case Value::NULL_TYPE: {
             return Value(BigNum());
         }
@@ -35,6 +45,31 @@ Value builtinNumber(const std::vector<Value>& args) {
     }
 }
 
+Value builtinFloat(const std::vector<Value>& args) {
+    checkArgCount("float", 1, args);
+
+    switch (args[0].type) {
+        case Value::FLOAT: {
+            return args[0];
+        }
+        case Value::NUMBER: {
+            return Value(args[0].bignumValue.to_double());
+        }
+        case Value::STRING: {
+            char* end = nullptr;
+            double value = strtod(args[0].strValue.c_str(), &end);
+            if (args[0].strValue.empty() || *end != '\0') {
+                throwTypeError("Cannot convert '" + args[0].strValue + "' to float!");
+            }
+            return Value(value);
+        }
+        default: {
+            throwTypeError("Cannot convert to float!");
+            return Value();
+        }
+    }
+}
+
 Value builtinStr(const std::vector<Value>& args) {
     checkArgCount("str", 1, args);
 
@@ -42,6 +77,9 @@ Value builtinStr(const std::vector<Value>& args) {
         case Value::NUMBER: {
             return Value(args[0].bignumValue.to_string());
         }
+        case Value::FLOAT: {
+            return Value(floatToString(args[0].floatValue));
+        }
         case Value::STRING: {
             return Value(args[0].strValue);
         }
@@ -61,6 +99,20 @@ Value builtinList(const std::vector<Value>& args) {
         case Value::LIST: {
             return Value(args[0].listValue);
         }
+        case Value::SET: {
+            std::vector<Value> list;
+            list.reserve(args[0].dictValue->size());
+            args[0].dictValue->forEachKey([&](const Value& key) { list.push_back(key); });
+            return Value(list);
+        }
+        case Value::ARRAY: {
+            std::vector<Value> list;
+            list.reserve(args[0].arrayValue->size());
+            for (size_t i = 0; i < args[0].arrayValue->size(); i++) {
+                list.push_back(args[0].arrayValue->at(i));
+            }
+            return Value(list);
+        }
         case Value::STRING: {
             std::vector<Value> list;
             for (char c : args[0].strValue) {
@@ -71,9 +123,10 @@ Value builtinList(const std::vector<Value>& args) {
         case Value::NULL_TYPE: {
             return Value(std::vector<Value>());
         }
-        case Value::NUMBER: {
+        case Value::NUMBER:
+        case Value::FLOAT: {
             std::vector<Value> list;
-            list.push_back(Value(args[0].bignumValue));
+            list.push_back(args[0]);
             return Value(list);
         }
         default: {
@@ -6,6 +6,9 @@
 
 Value builtinMathFloor(const std::vector<Value>& args) {
     checkArgCount("floor", 1, args);
+    if (args[0].type == Value::FLOAT) {
+        return Value(std::floor(args[0].floatValue));
+    }
     if (args[0].type != Value::NUMBER) {
         throwTypeError("floor() expects a number");
     }
@@ -14,6 +17,9 @@ Value builtinMathFloor(const std::vector<Value>& args) {
 
 Value builtinMathCeil(const std::vector<Value>& args) {
     checkArgCount("ceil", 1, args);
+    if (args[0].type == Value::FLOAT) {
+        return Value(std::ceil(args[0].floatValue));
+    }
     if (args[0].type!= Value::NUMBER) {
         throwTypeError("ceil() expects a number");
     }
@@ -22,6 +28,9 @@ Value builtinMathCeil(const std::vector<Value>& args) {
 
 Value builtinMathRound(const std::vector<Value>& args) {
     checkArgCount("round", 1, args);
+    if (args[0].type == Value::FLOAT) {
+        return Value(std::round(args[0].floatValue));
+    }
     if (args[0].type!= Value::NUMBER) {
         throwTypeError("round() expects a number");
     }
@@ -30,6 +39,9 @@ Value builtinMathRound(const std::vector<Value>& args) {
 
 Value builtinMathAbs(const std::vector<Value>& args) {
     checkArgCount("abs", 1, args);
+    if (args[0].type == Value::FLOAT) {
+        return Value(std::fabs(args[0].floatValue));
+    }
     if (args[0].type!= Value::NUMBER) {
         throwTypeError("abs() expects a number");
     }
@@ -38,14 +50,161 @@ Value builtinMathAbs(const std::vector<Value>& args) {
 
 Value builtinMathSqrt(const std::vector<Value>& args) {
     checkArgCount("sqrt", 1, args);
+    if (args[0].type == Value::FLOAT) {
+        return Value(std::sqrt(args[0].floatValue));
+    }
     if (args[0].type!= Value::NUMBER) {
         throwTypeError("sqrt() expects a number");
     }
     return Value(args[0].bignumValue.sqrt());
 }
 
+Value builtinMathDivmod(const std::vector<Value>& args) {
+    checkArgCount("divmod", 2, args);
+    if (args[0].type != Value::NUMBER || args[1].type != Value::NUMBER) {
+        throwTypeError("divmod() expects two numbers");
+    }
+    BigNum remainder;
+    BigNum quotient = args[0].bignumValue.divmod(args[1].bignumValue, remainder);
+    return Value(std::vector<Value>{Value(quotient), Value(remainder)});
+}
+
+Value builtinMathPowmod(const std::vector<Value>& args) {
+    checkArgCount("powmod", 3, args);
+    if (args[0].type != Value::NUMBER || args[1].type != Value::NUMBER || args[2].type != Value::NUMBER) {
+        throwTypeError("powmod() expects three numbers");
+    }
+    return Value(args[0].bignumValue.powmod(args[1].bignumValue, args[2].bignumValue));
+}
+
+Value builtinMathIsqrt(const std::vector<Value>& args) {
+    checkArgCount("isqrt", 1, args);
+    if (args[0].type != Value::NUMBER) {
+        throwTypeError("isqrt() expects a number");
+    }
+    return Value(args[0].bignumValue.isqrt());
+}
+
+Value builtinMathGcd(const std::vector<Value>& args) {
+    checkArgCount("gcd", 2, args);
+    if (args[0].type != Value::NUMBER || args[1].type != Value::NUMBER) {
+        throwTypeError("gcd() expects two numbers");
+    }
+    return Value(args[0].bignumValue.gcd(args[1].bignumValue));
+}
+
+Value builtinMathLcm(const std::vector<Value>& args) {
+    checkArgCount("lcm", 2, args);
+    if (args[0].type != Value::NUMBER || args[1].type != Value::NUMBER) {
+        throwTypeError("lcm() expects two numbers");
+    }
+    return Value(args[0].bignumValue.lcm(args[1].bignumValue));
+}
+
+Value builtinMathModinv(const std::vector<Value>& args) {
+    checkArgCount("modinv", 2, args);
+    if (args[0].type != Value::NUMBER || args[1].type != Value::NUMBER) {
+        throwTypeError("modinv() expects two numbers");
+    }
+    return Value(args[0].bignumValue.modinv(args[1].bignumValue));
+}
+
+Value builtinMathIsPrime(const std::vector<Value>& args) {
+    checkArgCount("is_prime", 1, args);
+    if (args[0].type != Value::NUMBER) {
+        throwTypeError("is_prime() expects a number");
+    }
+    return Value(BigNum(args[0].bignumValue.is_prime() ? 1 : 0));
+}
+
+Value builtinMathExp(const std::vector<Value>& args) {
+    checkArgCount("exp", 1, args);
+    if (args[0].type == Value::FLOAT) {
+        return Value(std::exp(args[0].floatValue));
+    }
+    if (args[0].type != Value::NUMBER) {
+        throwTypeError("exp() expects a number");
+    }
+    return Value(args[0].bignumValue.exp());
+}
+
+Value builtinMathLn(const std::vector<Value>& args) {
+    checkArgCount("ln", 1, args);
+    if (args[0].type == Value::FLOAT) {
+        return Value(std::log(args[0].floatValue));
+    }
+    if (args[0].type != Value::NUMBER) {
+        throwTypeError("ln() expects a number");
+    }
+    return Value(args[0].bignumValue.ln());
+}
+
+Value builtinMathSin(const std::vector<Value>& args) {
+    checkArgCount("sin", 1, args);
+    if (args[0].type == Value::FLOAT) {
+        return Value(std::sin(args[0].floatValue));
+    }
+    if (args[0].type != Value::NUMBER) {
+        throwTypeError("sin() expects a number");
+    }
+    return Value(args[0].bignumValue.sin());
+}
+
+Value builtinMathCos(const std::vector<Value>& args) {
+    checkArgCount("cos", 1, args);
+    if (args[0].type == Value::FLOAT) {
+        return Value(std::cos(args[0].floatValue));
+    }
+    if (args[0].type != Value::NUMBER) {
+        throwTypeError("cos() expects a number");
+    }
+    return Value(args[0].bignumValue.cos());
+}
+
+Value builtinMathAtan(const std::vector<Value>& args) {
+    checkArgCount("atan", 1, args);
+    if (args[0].type == Value::FLOAT) {
+        return Value(std::atan(args[0].floatValue));
+    }
+    if (args[0].type != Value::NUMBER) {
+        throwTypeError("atan() expects a number");
+    }
+    return Value(args[0].bignumValue.atan());
+}
+
+// pi() to the current precision, or pi(digits) to any number of digits.
+Value builtinMathPi(const std::vector<Value>& args) {
+    if (args.empty()) {
+        return Value(BigNum::pi(BigNum::precision()));
+    }
+    checkArgCount("pi", 1, args);
+    if (args[0].type != Value::NUMBER || !args[0].bignumValue.is_integer() || args[0].bignumValue < 0) {
+        throwTypeError("pi() expects a non-negative integer");
+    }
+    return Value(BigNum::pi((int)std::min(args[0].bignumValue.get_ll(), 1000000LL)));
+}
+
+// Sets the number of fractional digits kept by division, sqrt and
+// multiplication and returns the previous setting.
+Value builtinMathPrecision(const std::vector<Value>& args) {
+    checkArgCount("precision", 1, args);
+    if (args[0].type != Value::NUMBER || !args[0].bignumValue.is_integer() || args[0].bignumValue < 0) {
+        throwTypeError("precision() expects a non-negative integer");
+    }
+    int previous = BigNum::precision();
+    BigNum::set_precision((int)std::min(args[0].bignumValue.get_ll(), 1000000LL));
+    return Value(BigNum(previous));
+}
+
 Value builtinMathPow(const std::vector<Value>& args) {
     checkArgCount("pow", 2, args);
+    if ((args[0].type == Value::FLOAT || args[1].type == Value::FLOAT) &&
+        (args[0].type == Value::FLOAT || args[0].type == Value::NUMBER) &&
+        (args[1].type == Value::FLOAT || args[1].type == Value::NUMBER)) {
+        double base = args[0].type == Value::FLOAT ? args[0].floatValue : args[0].bignumValue.to_double();
+        double exponent = args[1].type == Value::FLOAT ? args[1].floatValue : args[1].bignumValue.to_double();
+        return Value(std::pow(base, exponent));
+    }
     if (args[0].type!= Value::NUMBER || args[1].type!= Value::NUMBER) {
         throwTypeError("pow() expects two numbers");
     }
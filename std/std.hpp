@@ -5,6 +5,9 @@
 #include "sys/files.hpp"
 #include "sys/time.hpp"
 #include "general/lists.hpp"
+#include "general/dicts.hpp"
+#include "general/strings.hpp"
+#include "general/arrays.hpp"
 #include "general/type.hpp"
 #include "general/IO.hpp"
 #include "maths/math.hpp"
@@ -9,7 +9,19 @@ Value builtinSystem(const std::vector<Value>& args) {
         throwTypeError("system() expects a string");
     }
     int result = std::system(args[0].strValue.c_str());
-    return Value(result);
+    return Value(BigNum(result));
+}
+
+// Sets how many threads large BigNum multiplications may use (0 = one per
+// core) and returns the previous count.
+Value builtinThreads(const std::vector<Value>& args) {
+    checkArgCount("threads", 1, args);
+    if (args[0].type != Value::NUMBER || !args[0].bignumValue.is_integer() || args[0].bignumValue < 0) {
+        throwTypeError("threads() expects a non-negative integer");
+    }
+    size_t previous = ThreadPool::instance().threadCount();
+    ThreadPool::instance().setThreadCount((size_t)std::min(args[0].bignumValue.get_ll(), 1024LL));
+    return Value(BigNum(previous));
 }
 
 Value builtinExit(const std::vector<Value>& args) {
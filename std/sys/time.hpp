@@ -15,7 +15,7 @@ Value builtinSleep(const std::vector<Value>& args) {
 }
 
 Value builtinTime() {
-    return Value(std::time(nullptr));
+    return Value(BigNum(std::time(nullptr)));
 }
 
 #endif
\ No newline at end of file
@@ -18,6 +18,8 @@
 #include "../parser/parser.hpp"
 #include "../bytecode/bytecode.hpp"
 #include "../bytecode/codegen.hpp"
+#include "../bytecode/optimizer.hpp"
+#include "../bytecode/assembler.hpp"
 #include "../parser/value.hpp"
 #include "../std/std.hpp"
 #include "../vm/vm.hpp"
@@ -2,8 +2,11 @@
 #define UTILS_HPP
 
 #include <string>
+#include <cmath>
 #include "../parser/value.hpp"
 #include "../parser/errors.hpp"
+#include "../vm/dict.hpp"
+#include "../vm/array.hpp"
 
 void checkArgCount(const std::string& func, size_t expected, const std::vector<Value>& args) {
     if (args.size() != expected) {
@@ -11,15 +14,67 @@ void checkArgCount(const std::string& func, size_t expected, const std::vector<V
     }
 }
 
+// Shortest decimal form that reads back as the same double; integral
+// values keep a ".0" so floats stay distinguishable from numbers.
+std::string floatToString(double value) {
+    if (std::isnan(value)) return "nan";
+    if (std::isinf(value)) return value < 0 ? "-inf" : "inf";
+    char buffer[32];
+    for (int digits = 15; digits <= 17; digits++) {
+        snprintf(buffer, sizeof(buffer), "%.*g", digits, value);
+        if (strtod(buffer, nullptr) == value) break;
+    }
+    std::string result = buffer;
+    if (result.find_first_of(".en") == std::string::npos) result += ".0";
+    return result;
+}
+
 void printValue(const Value& value) {
     switch (value.type) {
         case Value::NUMBER: printf("%s", value.bignumValue.to_string().c_str()); break;
+        case Value::FLOAT: printf("%s", floatToString(value.floatValue).c_str()); break;
         case Value::STRING: printf("%s", value.strValue.c_str()); break;
         case Value::LIST: {
             printf("[");
-            for (size_t i = 0; i < value.listValue.size(); ++i) {
-                printValue(value.listValue[i]);
-                if (i < value.listValue.size() - 1) printf(", ");
+            bool first = true;
+            value.listValue.forEach([&](const Value& item) {
+                if (!first) printf(", ");
+                first = false;
+                printValue(item);
+            });
+            printf("]");
+            break;
+        }
+        case Value::DICT: {
+            printf("{");
+            bool first = true;
+            value.dictValue->forEach([&](const Value& key, const Value& item) {
+                if (!first) printf(", ");
+                first = false;
+                printValue(key);
+                printf(": ");
+                printValue(item);
+            });
+            printf("}");
+            break;
+        }
+        case Value::SET: {
+            printf("{");
+            bool first = true;
+            value.dictValue->forEachKey([&](const Value& key) {
+                if (!first) printf(", ");
+                first = false;
+                printValue(key);
+            });
+            printf("}");
+            break;
+        }
+        case Value::ARRAY: {
+            const NumArray& array = *value.arrayValue;
+            printf(array.kind == NumArray::INT64 ? "int64[" : "float64[");
+            for (size_t i = 0; i < array.size(); ++i) {
+                if (i > 0) printf(", ");
+                printValue(array.at(i));
             }
             printf("]");
             break;
@@ -0,0 +1,168 @@
+#ifndef ARRAY_HPP
+#define ARRAY_HPP
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+#include "../parser/value.hpp"
+#include "../parser/errors.hpp"
+#include "../bytecode/bytecode.hpp"
+#include "array_kernels.hpp"
+
+// Typed numeric array behind Value::ARRAY: int64 or float64 elements packed
+// in one buffer, so the kernels in array_kernels.hpp can stream over them.
+// Like dicts, the buffer is shared between copies of the Value and written
+// through mutableArray().
+class NumArray {
+public:
+    enum Kind { INT64, FLOAT64 };
+
+    Kind kind;
+    std::vector<int64_t> ints;      // INT64 elements
+    std::vector<double> floats;     // FLOAT64 elements
+
+    explicit NumArray(Kind kind) : kind(kind) {}
+
+    size_t size() const {
+        return kind == INT64 ? ints.size() : floats.size();
+    }
+
+    Value at(size_t index) const {
+        if (kind == INT64) return Value(BigNum((long long)ints[index]));
+        return Value(floats[index]);
+    }
+
+    // Stores value converted to the element kind.
+    void set(size_t index, const Value& value);
+
+    // The elements as doubles: the buffer itself for a float64 array,
+    // otherwise a converted copy in storage.
+    const double* asFloats(std::vector<double>& storage) const {
+        if (kind == FLOAT64) return floats.data();
+        storage.assign(ints.begin(), ints.end());
+        return storage.data();
+    }
+};
+
+inline NumArray& mutableArray(Value& value) {
+    if (value.arrayValue.use_count() > 1) value.arrayValue = std::make_shared<NumArray>(*value.arrayValue);
+    return *value.arrayValue;
+}
+
+// A number as an int64 element, if it is an integer in range.
+inline bool exactInt64(const BigNum& number, int64_t& result) {
+    return number.fits_int64(result);
+}
+
+inline int64_t toInt64(const Value& value) {
+    int64_t result;
+    if (value.type != Value::NUMBER || !exactInt64(value.bignumValue, result)) {
+        throwTypeError("int64 elements must be integers in the int64 range");
+    }
+    return result;
+}
+
+inline double toFloat64(const Value& value) {
+    if (value.type == Value::FLOAT) return value.floatValue;
+    if (value.type == Value::NUMBER) return value.bignumValue.to_double();
+    throwTypeError("float64 elements must be numbers");
+    return 0;
+}
+
+inline void NumArray::set(size_t index, const Value& value) {
+    if (kind == INT64) {
+        ints[index] = toInt64(value);
+    } else {
+        floats[index] = toFloat64(value);
+    }
+}
+
+// One side of an elementwise operation: an array, or a number that is
+// broadcast over the other side with step 0.
+struct ArrayOperand {
+    const Value& value;
+    bool isArray;
+    bool isFloat;
+    int64_t intScalar = 0;
+    double floatScalar = 0;
+    std::vector<double> converted;
+
+    explicit ArrayOperand(const Value& value) : value(value), isArray(value.type == Value::ARRAY) {
+        if (isArray) {
+            isFloat = value.arrayValue->kind == NumArray::FLOAT64;
+        } else if (value.type == Value::NUMBER) {
+            isFloat = !exactInt64(value.bignumValue, intScalar);
+            if (isFloat) floatScalar = value.bignumValue.to_double();
+        } else if (value.type == Value::FLOAT) {
+            isFloat = true;
+            floatScalar = value.floatValue;
+        } else {
+            throwTypeError("Array operands must be arrays or numbers");
+        }
+    }
+
+    size_t step() const {
+        return isArray ? 1 : 0;
+    }
+
+    const int64_t* ints() const {
+        return isArray ? value.arrayValue->ints.data() : &intScalar;
+    }
+
+    const double* floats() {
+        if (isArray) return value.arrayValue->asFloats(converted);
+        if (!isFloat) floatScalar = (double)intScalar;
+        return &floatScalar;
+    }
+};
+
+inline array_kernels::Op arrayKernelOp(BinaryOperator op) {
+    switch (op) {
+        case OP_ADD: return array_kernels::ADD;
+        case OP_SUB: return array_kernels::SUB;
+        case OP_MUL: return array_kernels::MUL;
+        case OP_DIV: return array_kernels::DIV;
+        case OP_LT: return array_kernels::LT;
+        case OP_LE: return array_kernels::LE;
+        case OP_GT: return array_kernels::GT;
+        case OP_GE: return array_kernels::GE;
+        case OP_EQ: return array_kernels::EQ;
+        case OP_NE: return array_kernels::NE;
+        default:
+            throwTypeError(std::string("Operator ") + binaryOperatorSymbol(op) + " is not supported for arrays");
+            return array_kernels::ADD;
+    }
+}
+
+// Elementwise a op b where at least one side is an array and the other is
+// an array of the same length or a number. Comparisons give an int64 array
+// of 0 and 1. The result is float64 if either side is, and for /.
+inline Value arrayBinaryOp(const Value& left, const Value& right, BinaryOperator op) {
+    array_kernels::Op kernelOp = arrayKernelOp(op);
+    ArrayOperand a(left), b(right);
+    size_t n = a.isArray ? left.arrayValue->size() : right.arrayValue->size();
+    if (a.isArray && b.isArray && right.arrayValue->size() != n) {
+        throwRuntimeError("Array lengths differ");
+    }
+
+    bool comparison = array_kernels::is_comparison(kernelOp);
+    bool floating = a.isFloat || b.isFloat || kernelOp == array_kernels::DIV;
+    auto result = std::make_shared<NumArray>(floating && !comparison ? NumArray::FLOAT64 : NumArray::INT64);
+    if (result->kind == NumArray::FLOAT64) {
+        result->floats.resize(n);
+        array_kernels::f64_arith(kernelOp, result->floats.data(), a.floats(), a.step(), b.floats(), b.step(), n);
+    } else {
+        result->ints.resize(n);
+        if (!comparison) {
+            array_kernels::i64_arith(kernelOp, result->ints.data(), a.ints(), a.step(), b.ints(), b.step(), n);
+        } else if (floating) {
+            array_kernels::f64_compare(kernelOp, result->ints.data(), a.floats(), a.step(), b.floats(), b.step(), n);
+        } else {
+            array_kernels::i64_compare(kernelOp, result->ints.data(), a.ints(), a.step(), b.ints(), b.step(), n);
+        }
+    }
+    return Value(result);
+}
+
+#endif
@@ -0,0 +1,373 @@
+#ifndef ARRAY_KERNELS_HPP
+#define ARRAY_KERNELS_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define ARRAY_KERNELS_X86 1
+#endif
+
+// Loops over the packed int64 / float64 buffers of typed arrays. Elementwise
+// kernels read a[i * sa] and b[i * sb], so a step of 0 broadcasts a scalar
+// operand, and r may alias a or b. The AVX2 versions handle 4 elements per
+// step and are picked at runtime; other CPUs run the scalar loops. AVX2 has
+// no 64-bit multiply, so int64 * and int64 dot are always scalar. int64
+// arithmetic wraps around. Sums and dot products keep 8 partial sums, so a
+// float result may differ in the last bits from a left-to-right sum.
+namespace array_kernels {
+
+enum Op { ADD, SUB, MUL, DIV, LT, LE, GT, GE, EQ, NE };
+
+constexpr bool is_comparison(Op op) {
+    return op >= LT;
+}
+
+// Below this many elements the dispatch costs more than it saves.
+const size_t SIMD_MIN_ELEMENTS = 8;
+
+template<Op OP, typename T>
+inline auto apply(T x, T y) {
+    if constexpr (OP == LT) return (int64_t)(x < y);
+    else if constexpr (OP == LE) return (int64_t)(x <= y);
+    else if constexpr (OP == GT) return (int64_t)(x > y);
+    else if constexpr (OP == GE) return (int64_t)(x >= y);
+    else if constexpr (OP == EQ) return (int64_t)(x == y);
+    else if constexpr (OP == NE) return (int64_t)(x != y);
+    else if constexpr (std::is_same<T, int64_t>::value) {
+        static_assert(OP != DIV, "int64 arrays divide as float64");
+        uint64_t ux = x, uy = y;
+        if constexpr (OP == ADD) return (int64_t)(ux + uy);
+        else if constexpr (OP == SUB) return (int64_t)(ux - uy);
+        else return (int64_t)(ux * uy);
+    } else {
+        if constexpr (OP == ADD) return x + y;
+        else if constexpr (OP == SUB) return x - y;
+        else if constexpr (OP == MUL) return x * y;
+        else return x / y;
+    }
+}
+
+template<Op OP, typename T, typename R>
+inline void map_scalar(R* r, const T* a, size_t sa, const T* b, size_t sb, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        r[i] = apply<OP>(a[i * sa], b[i * sb]);
+    }
+}
+
+template<typename T>
+inline T sum_scalar(const T* a, size_t n) {
+    T sum = 0;
+    for (size_t i = 0; i < n; i++) sum = apply<ADD>(sum, a[i]);
+    return sum;
+}
+
+template<typename T>
+inline T dot_scalar(const T* a, const T* b, size_t n) {
+    T sum = 0;
+    for (size_t i = 0; i < n; i++) sum = apply<ADD>(sum, apply<MUL>(a[i], b[i]));
+    return sum;
+}
+
+template<bool MAX, typename T>
+inline T extreme_scalar(const T* a, size_t n) {
+    T best = a[0];
+    for (size_t i = 1; i < n; i++) {
+        if (MAX ? a[i] > best : a[i] < best) best = a[i];
+    }
+    return best;
+}
+
+#ifdef ARRAY_KERNELS_X86
+
+template<Op OP>
+__attribute__((target("avx2")))
+inline void f64_arith_avx2(double* r, const double* a, size_t sa, const double* b, size_t sb, size_t n) {
+    const __m256d va = _mm256_set1_pd(a[0]);
+    const __m256d vb = _mm256_set1_pd(b[0]);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d x = sa ? _mm256_loadu_pd(a + i) : va;
+        __m256d y = sb ? _mm256_loadu_pd(b + i) : vb;
+        __m256d z;
+        if constexpr (OP == ADD) z = _mm256_add_pd(x, y);
+        else if constexpr (OP == SUB) z = _mm256_sub_pd(x, y);
+        else if constexpr (OP == MUL) z = _mm256_mul_pd(x, y);
+        else z = _mm256_div_pd(x, y);
+        _mm256_storeu_pd(r + i, z);
+    }
+    map_scalar<OP>(r + i, a + i * sa, sa, b + i * sb, sb, n - i);
+}
+
+template<Op OP>
+__attribute__((target("avx2")))
+inline void f64_compare_avx2(int64_t* r, const double* a, size_t sa, const double* b, size_t sb, size_t n) {
+    constexpr int predicate = OP == LT ? _CMP_LT_OQ : OP == LE ? _CMP_LE_OQ : OP == GT ? _CMP_GT_OQ
+                            : OP == GE ? _CMP_GE_OQ : OP == EQ ? _CMP_EQ_OQ : _CMP_NEQ_UQ;
+    const __m256d va = _mm256_set1_pd(a[0]);
+    const __m256d vb = _mm256_set1_pd(b[0]);
+    const __m256i one = _mm256_set1_epi64x(1);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d x = sa ? _mm256_loadu_pd(a + i) : va;
+        __m256d y = sb ? _mm256_loadu_pd(b + i) : vb;
+        __m256i mask = _mm256_castpd_si256(_mm256_cmp_pd(x, y, predicate));
+        _mm256_storeu_si256((__m256i*)(r + i), _mm256_and_si256(mask, one));
+    }
+    map_scalar<OP>(r + i, a + i * sa, sa, b + i * sb, sb, n - i);
+}
+
+// ADD and SUB only.
+template<Op OP>
+__attribute__((target("avx2")))
+inline void i64_arith_avx2(int64_t* r, const int64_t* a, size_t sa, const int64_t* b, size_t sb, size_t n) {
+    const __m256i va = _mm256_set1_epi64x(a[0]);
+    const __m256i vb = _mm256_set1_epi64x(b[0]);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = sa ? _mm256_loadu_si256((const __m256i*)(a + i)) : va;
+        __m256i y = sb ? _mm256_loadu_si256((const __m256i*)(b + i)) : vb;
+        __m256i z = OP == ADD ? _mm256_add_epi64(x, y) : _mm256_sub_epi64(x, y);
+        _mm256_storeu_si256((__m256i*)(r + i), z);
+    }
+    map_scalar<OP>(r + i, a + i * sa, sa, b + i * sb, sb, n - i);
+}
+
+// Only == and > exist for int64 lanes: < swaps the operands, and the
+// negated comparisons turn the all-ones mask into 0 and the zero mask into
+// 1 by adding 1, where the others keep its low bit.
+template<Op OP>
+__attribute__((target("avx2")))
+inline void i64_compare_avx2(int64_t* r, const int64_t* a, size_t sa, const int64_t* b, size_t sb, size_t n) {
+    constexpr bool negate = OP == LE || OP == GE || OP == NE;
+    const __m256i va = _mm256_set1_epi64x(a[0]);
+    const __m256i vb = _mm256_set1_epi64x(b[0]);
+    const __m256i one = _mm256_set1_epi64x(1);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = sa ? _mm256_loadu_si256((const __m256i*)(a + i)) : va;
+        __m256i y = sb ? _mm256_loadu_si256((const __m256i*)(b + i)) : vb;
+        __m256i mask;
+        if constexpr (OP == EQ || OP == NE) mask = _mm256_cmpeq_epi64(x, y);
+        else if constexpr (OP == GT || OP == LE) mask = _mm256_cmpgt_epi64(x, y);
+        else mask = _mm256_cmpgt_epi64(y, x);
+        __m256i z = negate ? _mm256_add_epi64(mask, one) : _mm256_and_si256(mask, one);
+        _mm256_storeu_si256((__m256i*)(r + i), z);
+    }
+    map_scalar<OP>(r + i, a + i * sa, sa, b + i * sb, sb, n - i);
+}
+
+__attribute__((target("avx2")))
+inline double f64_sum_avx2(const double* a, size_t n) {
+    __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        s0 = _mm256_add_pd(s0, _mm256_loadu_pd(a + i));
+        s1 = _mm256_add_pd(s1, _mm256_loadu_pd(a + i + 4));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(s0, s1));
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) + sum_scalar(a + i, n - i);
+}
+
+__attribute__((target("avx2")))
+inline double f64_dot_avx2(const double* a, const double* b, size_t n) {
+    __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        s0 = _mm256_add_pd(s0, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+        s1 = _mm256_add_pd(s1, _mm256_mul_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4)));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(s0, s1));
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) + dot_scalar(a + i, b + i, n - i);
+}
+
+template<bool MAX>
+__attribute__((target("avx2")))
+inline double f64_extreme_avx2(const double* a, size_t n) {
+    __m256d best = _mm256_loadu_pd(a);
+    size_t i = 4;
+    for (; i + 4 <= n; i += 4) {
+        __m256d x = _mm256_loadu_pd(a + i);
+        best = MAX ? _mm256_max_pd(best, x) : _mm256_min_pd(best, x);
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, best);
+    double result = extreme_scalar<MAX>(lanes, 4);
+    if (i < n) {
+        double tail = extreme_scalar<MAX>(a + i, n - i);
+        if (MAX ? tail > result : tail < result) result = tail;
+    }
+    return result;
+}
+
+__attribute__((target("avx2")))
+inline int64_t i64_sum_avx2(const int64_t* a, size_t n) {
+    __m256i s0 = _mm256_setzero_si256(), s1 = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        s0 = _mm256_add_epi64(s0, _mm256_loadu_si256((const __m256i*)(a + i)));
+        s1 = _mm256_add_epi64(s1, _mm256_loadu_si256((const __m256i*)(a + i + 4)));
+    }
+    int64_t lanes[4];
+    _mm256_storeu_si256((__m256i*)lanes, _mm256_add_epi64(s0, s1));
+    return apply<ADD>(sum_scalar(lanes, 4), sum_scalar(a + i, n - i));
+}
+
+template<bool MAX>
+__attribute__((target("avx2")))
+inline int64_t i64_extreme_avx2(const int64_t* a, size_t n) {
+    __m256i best = _mm256_loadu_si256((const __m256i*)a);
+    size_t i = 4;
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i better = MAX ? _mm256_cmpgt_epi64(x, best) : _mm256_cmpgt_epi64(best, x);
+        best = _mm256_blendv_epi8(best, x, better);
+    }
+    int64_t lanes[4];
+    _mm256_storeu_si256((__m256i*)lanes, best);
+    int64_t result = extreme_scalar<MAX>(lanes, 4);
+    if (i < n) {
+        int64_t tail = extreme_scalar<MAX>(a + i, n - i);
+        if (MAX ? tail > result : tail < result) result = tail;
+    }
+    return result;
+}
+
+#endif
+
+inline bool use_avx2() {
+    static const bool avx2 = [] {
+#ifdef ARRAY_KERNELS_X86
+        __builtin_cpu_init();
+        return (bool)__builtin_cpu_supports("avx2");
+#else
+        return false;
+#endif
+    }();
+    return avx2;
+}
+
+inline bool simd(size_t n) {
+    return n >= SIMD_MIN_ELEMENTS && use_avx2();
+}
+
+// Calls f(std::integral_constant<Op, op>()), so that the kernels get the
+// operator as a template argument.
+template<typename F>
+inline void with_op(Op op, F&& f) {
+    switch (op) {
+        case ADD: f(std::integral_constant<Op, ADD>()); break;
+        case SUB: f(std::integral_constant<Op, SUB>()); break;
+        case MUL: f(std::integral_constant<Op, MUL>()); break;
+        case DIV: f(std::integral_constant<Op, DIV>()); break;
+        case LT: f(std::integral_constant<Op, LT>()); break;
+        case LE: f(std::integral_constant<Op, LE>()); break;
+        case GT: f(std::integral_constant<Op, GT>()); break;
+        case GE: f(std::integral_constant<Op, GE>()); break;
+        case EQ: f(std::integral_constant<Op, EQ>()); break;
+        case NE: f(std::integral_constant<Op, NE>()); break;
+    }
+}
+
+// r[i] = a[i * sa] op b[i * sb] for op ADD, SUB, MUL or DIV.
+inline void f64_arith(Op op, double* r, const double* a, size_t sa, const double* b, size_t sb, size_t n) {
+    with_op(op, [&](auto tag) {
+        constexpr Op OP = decltype(tag)::value;
+        if constexpr (!is_comparison(OP)) {
+#ifdef ARRAY_KERNELS_X86
+            if (simd(n)) return f64_arith_avx2<OP>(r, a, sa, b, sb, n);
+#endif
+            map_scalar<OP>(r, a, sa, b, sb, n);
+        }
+    });
+}
+
+// r[i] = 1 if a[i * sa] op b[i * sb] holds, else 0, for a comparison op.
+inline void f64_compare(Op op, int64_t* r, const double* a, size_t sa, const double* b, size_t sb, size_t n) {
+    with_op(op, [&](auto tag) {
+        constexpr Op OP = decltype(tag)::value;
+        if constexpr (is_comparison(OP)) {
+#ifdef ARRAY_KERNELS_X86
+            if (simd(n)) return f64_compare_avx2<OP>(r, a, sa, b, sb, n);
+#endif
+            map_scalar<OP>(r, a, sa, b, sb, n);
+        }
+    });
+}
+
+// As f64_arith for op ADD, SUB or MUL.
+inline void i64_arith(Op op, int64_t* r, const int64_t* a, size_t sa, const int64_t* b, size_t sb, size_t n) {
+    with_op(op, [&](auto tag) {
+        constexpr Op OP = decltype(tag)::value;
+        if constexpr (OP == ADD || OP == SUB || OP == MUL) {
+#ifdef ARRAY_KERNELS_X86
+            if constexpr (OP != MUL) {
+                if (simd(n)) return i64_arith_avx2<OP>(r, a, sa, b, sb, n);
+            }
+#endif
+            map_scalar<OP>(r, a, sa, b, sb, n);
+        }
+    });
+}
+
+inline void i64_compare(Op op, int64_t* r, const int64_t* a, size_t sa, const int64_t* b, size_t sb, size_t n) {
+    with_op(op, [&](auto tag) {
+        constexpr Op OP = decltype(tag)::value;
+        if constexpr (is_comparison(OP)) {
+#ifdef ARRAY_KERNELS_X86
+            if (simd(n)) return i64_compare_avx2<OP>(r, a, sa, b, sb, n);
+#endif
+            map_scalar<OP>(r, a, sa, b, sb, n);
+        }
+    });
+}
+
+inline double f64_sum(const double* a, size_t n) {
+#ifdef ARRAY_KERNELS_X86
+    if (simd(n)) return f64_sum_avx2(a, n);
+#endif
+    return sum_scalar(a, n);
+}
+
+inline int64_t i64_sum(const int64_t* a, size_t n) {
+#ifdef ARRAY_KERNELS_X86
+    if (simd(n)) return i64_sum_avx2(a, n);
+#endif
+    return sum_scalar(a, n);
+}
+
+inline double f64_dot(const double* a, const double* b, size_t n) {
+#ifdef ARRAY_KERNELS_X86
+    if (simd(n)) return f64_dot_avx2(a, b, n);
+#endif
+    return dot_scalar(a, b, n);
+}
+
+inline int64_t i64_dot(const int64_t* a, const int64_t* b, size_t n) {
+    return dot_scalar(a, b, n);
+}
+
+// Smallest or largest of a[0..n), n > 0.
+template<bool MAX>
+inline double f64_extreme(const double* a, size_t n) {
+#ifdef ARRAY_KERNELS_X86
+    if (simd(n)) return f64_extreme_avx2<MAX>(a, n);
+#endif
+    return extreme_scalar<MAX>(a, n);
+}
+
+template<bool MAX>
+inline int64_t i64_extreme(const int64_t* a, size_t n) {
+#ifdef ARRAY_KERNELS_X86
+    if (simd(n)) return i64_extreme_avx2<MAX>(a, n);
+#endif
+    return extreme_scalar<MAX>(a, n);
+}
+
+}
+
+#endif
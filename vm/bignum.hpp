@@ -2,489 +2,1609 @@
 #define BIGNUM_HPP
 
 #include <vector>
+#include <cstdint>
 #include <string>
 #include <algorithm>
-#include <complex>
+#include <deque>
 #include <cmath>
 #include <stdexcept>
 #include <type_traits>
 #include <iomanip>
+#include <random>
 #include "../parser/errors.hpp"
+#include "limb_kernels.hpp"
+#include "thread_pool.hpp"
 
 using namespace std;
 
-const double PI = acos(-1);
-const int DECIMAL_LIMIT = 20;
+
+// Little-endian uint32_t limb storage with room for INLINE_LIMBS limbs
+// inside the object, so numbers up to 128 bits never touch the heap.
+// Provides the subset of std::vector the BigNum helpers use.
+class limb_vector {
+public:
+    static const uint32_t INLINE_LIMBS = 4;
+
+    limb_vector() : ptr(buf), len(0), cap(INLINE_LIMBS) {}
+
+    explicit limb_vector(size_t n, uint32_t value = 0) : limb_vector() {
+        assign(n, value);
+    }
+
+    limb_vector(const uint32_t* first, const uint32_t* last) : limb_vector() {
+        reserve(last - first);
+        copy(first, last, ptr);
+        len = (uint32_t)(last - first);
+    }
+
+    limb_vector(const limb_vector& other) : limb_vector(other.begin(), other.end()) {}
+
+    limb_vector(limb_vector&& other) noexcept : limb_vector() {
+        steal(other);
+    }
+
+    limb_vector& operator=(const limb_vector& other) {
+        if (this != &other) {
+            len = 0;
+            reserve(other.len);
+            copy(other.begin(), other.end(), ptr);
+            len = other.len;
+        }
+        return *this;
+    }
+
+    limb_vector& operator=(limb_vector&& other) noexcept {
+        if (this != &other) {
+            release();
+            steal(other);
+        }
+        return *this;
+    }
+
+    ~limb_vector() {
+        release();
+    }
+
+    size_t size() const { return len; }
+    bool empty() const { return len == 0; }
+    uint32_t* data() { return ptr; }
+    const uint32_t* data() const { return ptr; }
+    uint32_t* begin() { return ptr; }
+    uint32_t* end() { return ptr + len; }
+    const uint32_t* begin() const { return ptr; }
+    const uint32_t* end() const { return ptr + len; }
+    uint32_t& operator[](size_t i) { return ptr[i]; }
+    const uint32_t& operator[](size_t i) const { return ptr[i]; }
+    uint32_t& back() { return ptr[len - 1]; }
+    const uint32_t& back() const { return ptr[len - 1]; }
+
+    void reserve(size_t n) {
+        if (n <= cap) return;
+        uint32_t* grown = new uint32_t[n];
+        copy(ptr, ptr + len, grown);
+        release();
+        ptr = grown;
+        cap = (uint32_t)n;
+    }
+
+    void push_back(uint32_t value) {
+        if (len == cap) reserve(2 * (size_t)cap);
+        ptr[len++] = value;
+    }
+
+    void pop_back() { --len; }
+
+    void resize(size_t n, uint32_t value = 0) {
+        reserve(n);
+        if (n > len) fill(ptr + len, ptr + n, value);
+        len = (uint32_t)n;
+    }
+
+    void assign(size_t n, uint32_t value) {
+        len = 0;
+        resize(n, value);
+    }
+
+    // Only used to prepend zero limbs (multiply by a power of 2^32).
+    void insert(uint32_t* pos, size_t n, uint32_t value) {
+        size_t at = pos - ptr;
+        size_t old = len;
+        resize(len + n);
+        copy_backward(ptr + at, ptr + old, ptr + len);
+        fill(ptr + at, ptr + at + n, value);
+    }
+
+    void swap(limb_vector& other) {
+        limb_vector tmp(std::move(other));
+        other = std::move(*this);
+        *this = std::move(tmp);
+    }
+
+    bool operator==(const limb_vector& other) const {
+        return len == other.len && equal(begin(), end(), other.begin());
+    }
+
+    bool operator!=(const limb_vector& other) const { return !(*this == other); }
+
+private:
+    uint32_t* ptr;
+    uint32_t len;
+    uint32_t cap;
+    uint32_t buf[INLINE_LIMBS];
+
+    void release() {
+        if (ptr != buf) delete[] ptr;
+        ptr = buf;
+        cap = INLINE_LIMBS;
+    }
+
+    void steal(limb_vector& other) {
+        if (other.ptr == other.buf) {
+            copy(other.buf, other.buf + other.len, buf);
+            ptr = buf;
+            cap = INLINE_LIMBS;
+        } else {
+            ptr = other.ptr;
+            cap = other.cap;
+            other.ptr = other.buf;
+            other.cap = INLINE_LIMBS;
+        }
+        len = other.len;
+        other.len = 0;
+    }
+};
+
 
 class BigNum {
 private:
+    // value = (is_negative ? -1 : 1) * mantissa * 10^-scale, scale >= 0
     bool is_negative;
-    vector<int> integer;
-    vector<int> decimal;
-
-    static void fft(vector<complex<double>>& a, bool invert) {
-        int n = a.size();
-        if (n == 0) return;
-
-        for (int i = 1, j = 0; i < n; i++) {
-            int bit = n >> 1;
-            for (; j >= bit; bit >>= 1)
-                j -= bit;
-            j += bit;
-            if (i < j)
-                swap(a[i], a[j]);
-        }
-
-        for (int len = 2; len <= n; len <<= 1) {
-            double ang = 2 * PI / len * (invert ? -1 : 1);
-            complex<double> wlen(cos(ang), sin(ang));
-            for (int i = 0; i < n; i += len) {
-                complex<double> w(1);
-                for (int j = 0; j < len/2; j++) {
-                    complex<double> u = a[i+j];
-                    complex<double> v = a[i+j+len/2] * w;
-                    a[i+j] = u + v;
-                    a[i+j+len/2] = u - v;
-                    w *= wlen;
-                }
-            }
+    limb_vector mantissa;
+    int scale;
+
+    static inline int current_precision = 20;
+
+    // Limb helpers. A limb vector is little-endian base 2^32 and always
+    // holds at least one limb; zero is {0}.
+    static void trim(limb_vector& a) {
+        while (a.size() > 1 && a.back() == 0)
+            a.pop_back();
+    }
+
+    static int compare_limbs(const limb_vector& a, const limb_vector& b) {
+        if (a.size() != b.size())
+            return (a.size() < b.size()) ? -1 : 1;
+        return limb_kernels::cmp_n(a.data(), b.data(), a.size());
+    }
+
+    static limb_vector add_limbs(const limb_vector& a, const limb_vector& b) {
+        const limb_vector& lo = a.size() < b.size() ? a : b;
+        const limb_vector& hi = a.size() < b.size() ? b : a;
+        limb_vector result(hi.size() + 1);
+        uint32_t carry = limb_kernels::add_n(result.data(), hi.data(), lo.data(), lo.size());
+        carry = limb_kernels::add_1(result.data() + lo.size(), hi.data() + lo.size(), hi.size() - lo.size(), carry);
+        result[hi.size()] = carry;
+        trim(result);
+        return result;
+    }
+
+    // Requires a >= b.
+    static limb_vector sub_limbs(const limb_vector& a, const limb_vector& b) {
+        limb_vector result(a.size());
+        uint32_t borrow = limb_kernels::sub_n(result.data(), a.data(), b.data(), b.size());
+        limb_kernels::sub_1(result.data() + b.size(), a.data() + b.size(), a.size() - b.size(), borrow);
+        trim(result);
+        return result;
+    }
+
+    static void mul_small_add(limb_vector& a, uint32_t m, uint32_t add) {
+        uint64_t carry = add;
+        for (uint32_t& limb : a) {
+            uint64_t cur = (uint64_t)limb * m + carry;
+            limb = (uint32_t)cur;
+            carry = cur >> 32;
         }
+        if (carry) a.push_back((uint32_t)carry);
+        trim(a);
+    }
 
-        if (invert) {
-            for (complex<double>& x : a)
-                x /= n;
+    // Divides a in place and returns the remainder.
+    static uint32_t divmod_small(limb_vector& a, uint32_t d) {
+        uint64_t rem = 0;
+        for (size_t i = a.size(); i-- > 0;) {
+            uint64_t cur = (rem << 32) | a[i];
+            a[i] = (uint32_t)(cur / d);
+            rem = cur % d;
         }
+        trim(a);
+        return (uint32_t)rem;
     }
 
-    bool is_zero() const {
-        return integer.size() == 1 && integer[0] == 0 && decimal.empty();
+    // Multiplication tiers, by the size of the shorter operand in limbs.
+    // Tuned with 2^32 limbs on x86-64; see mul_limbs.
+    static constexpr size_t KARATSUBA_THRESHOLD = 56;
+    static constexpr size_t TOOM3_THRESHOLD = 128;
+    static constexpr size_t NTT_THRESHOLD = 3000;
+    // Keeps every convolution term below the product of the NTT primes.
+    static constexpr size_t NTT_MAX_LENGTH = size_t(1) << 22;
+
+    static limb_vector mul_schoolbook(const limb_vector& a, const limb_vector& b) {
+        limb_vector result(a.size() + b.size(), 0);
+        for (size_t i = 0; i < a.size(); ++i) {
+            uint64_t carry = 0;
+            for (size_t j = 0; j < b.size(); ++j) {
+                uint64_t cur = (uint64_t)a[i] * b[j] + result[i + j] + carry;
+                result[i + j] = (uint32_t)cur;
+                carry = cur >> 32;
+            }
+            result[i + b.size()] = (uint32_t)carry;
+        }
+        trim(result);
+        return result;
     }
 
+    static limb_vector slice_limbs(const limb_vector& a, size_t from, size_t to) {
+        from = min(from, a.size());
+        to = min(to, a.size());
+        if (from >= to) return limb_vector(1, 0);
+        limb_vector result(a.begin() + from, a.begin() + to);
+        trim(result);
+        return result;
+    }
 
-    void normalize() {
-        while (integer.size() > 1 && integer.back() == 0)
-            integer.pop_back();
+    // acc += v * 2^(32 * shift)
+    static void add_shifted(limb_vector& acc, const limb_vector& v, size_t shift) {
+        if (acc.size() < v.size() + shift + 1)
+            acc.resize(v.size() + shift + 1, 0);
+        uint64_t carry = limb_kernels::add_n(acc.data() + shift, acc.data() + shift, v.data(), v.size());
+        for (size_t i = v.size() + shift; carry; ++i) {
+            if (i == acc.size()) acc.push_back(0);
+            uint64_t sum = (uint64_t)acc[i] + carry;
+            acc[i] = (uint32_t)sum;
+            carry = sum >> 32;
+        }
+    }
 
+    static limb_vector mul_karatsuba(const limb_vector& a, const limb_vector& b) {
+        size_t k = max(a.size(), b.size()) / 2;
+        limb_vector a0 = slice_limbs(a, 0, k), a1 = slice_limbs(a, k, a.size());
+        limb_vector b0 = slice_limbs(b, 0, k), b1 = slice_limbs(b, k, b.size());
 
-        while (decimal.size() > DECIMAL_LIMIT)
-            decimal.pop_back();
-        while (decimal.size() > 0 && decimal.back() == 0)
-            decimal.pop_back();
+        limb_vector z0 = mul_limbs(a0, b0);
+        limb_vector z2 = mul_limbs(a1, b1);
+        limb_vector z1 = mul_limbs(add_limbs(a0, a1), add_limbs(b0, b1));
+        z1 = sub_limbs(sub_limbs(z1, z0), z2);
 
+        limb_vector result = z0;
+        add_shifted(result, z1, k);
+        add_shifted(result, z2, 2 * k);
+        trim(result);
+        return result;
+    }
 
-        if (integer.size() == 1 && integer[0] == 0 && decimal.empty())
-            is_negative = false;
+    struct SignedLimbs {
+        limb_vector mag;
+        bool neg;
+    };
+
+    static SignedLimbs signed_add(const SignedLimbs& a, const SignedLimbs& b) {
+        if (a.neg == b.neg) return {add_limbs(a.mag, b.mag), a.neg};
+        int cmp = compare_limbs(a.mag, b.mag);
+        if (cmp >= 0) return {sub_limbs(a.mag, b.mag), a.neg && cmp != 0};
+        return {sub_limbs(b.mag, a.mag), b.neg};
     }
 
-public:
+    static SignedLimbs signed_sub(const SignedLimbs& a, const SignedLimbs& b) {
+        return signed_add(a, {b.mag, !b.neg});
+    }
+
+    static SignedLimbs signed_mul(const SignedLimbs& a, const SignedLimbs& b) {
+        return {mul_limbs(a.mag, b.mag), a.neg != b.neg};
+    }
 
-    BigNum() : is_negative(false), integer(1, 0) {}
+    // Exact division by a small constant.
+    static SignedLimbs signed_div(SignedLimbs a, uint32_t d) {
+        divmod_small(a.mag, d);
+        return a;
+    }
 
-    BigNum trunc() const {
-        BigNum result = *this;
-        result.decimal.clear();
-        result.normalize();
+    // Toom-Cook 3-way, evaluated at 0, 1, -1, -2 and infinity with
+    // Bodrato's interpolation sequence.
+    static limb_vector mul_toom3(const limb_vector& a, const limb_vector& b) {
+        size_t k = (max(a.size(), b.size()) + 2) / 3;
+        SignedLimbs a0 = {slice_limbs(a, 0, k), false}, a1 = {slice_limbs(a, k, 2 * k), false}, a2 = {slice_limbs(a, 2 * k, a.size()), false};
+        SignedLimbs b0 = {slice_limbs(b, 0, k), false}, b1 = {slice_limbs(b, k, 2 * k), false}, b2 = {slice_limbs(b, 2 * k, b.size()), false};
+
+        SignedLimbs pa = signed_add(a0, a2), pb = signed_add(b0, b2);
+        SignedLimbs a_1 = signed_add(pa, a1), b_1 = signed_add(pb, b1);
+        SignedLimbs a_m1 = signed_sub(pa, a1), b_m1 = signed_sub(pb, b1);
+        SignedLimbs a_m2 = signed_add(a_m1, a2), b_m2 = signed_add(b_m1, b2);
+        mul_small_add(a_m2.mag, 2, 0);
+        mul_small_add(b_m2.mag, 2, 0);
+        a_m2 = signed_sub(a_m2, a0);
+        b_m2 = signed_sub(b_m2, b0);
+
+        SignedLimbs r0 = signed_mul(a0, b0);
+        SignedLimbs r1 = signed_mul(a_1, b_1);
+        SignedLimbs r_m1 = signed_mul(a_m1, b_m1);
+        SignedLimbs r_m2 = signed_mul(a_m2, b_m2);
+        SignedLimbs r_inf = signed_mul(a2, b2);
+
+        SignedLimbs t3 = signed_div(signed_sub(r_m2, r1), 3);
+        SignedLimbs t1 = signed_div(signed_sub(r1, r_m1), 2);
+        SignedLimbs t2 = signed_sub(r_m1, r0);
+        SignedLimbs twice_inf = r_inf;
+        mul_small_add(twice_inf.mag, 2, 0);
+        t3 = signed_add(signed_div(signed_sub(t2, t3), 2), twice_inf);
+        t2 = signed_sub(signed_add(t2, t1), r_inf);
+        t1 = signed_sub(t1, t3);
+
+        limb_vector result = r0.mag;
+        add_shifted(result, t1.mag, k);
+        add_shifted(result, t2.mag, 2 * k);
+        add_shifted(result, t3.mag, 3 * k);
+        add_shifted(result, r_inf.mag, 4 * k);
+        trim(result);
         return result;
     }
 
-    explicit BigNum(const string& s) {
-        string num = s;
-        is_negative = false;
+    // Splits the longer operand into pieces the size of the shorter one so
+    // the balanced kernels see square products.
+    static limb_vector mul_unbalanced(const limb_vector& big, const limb_vector& small) {
+        limb_vector result(big.size() + small.size(), 0);
+        for (size_t i = 0; i < big.size(); i += small.size()) {
+            add_shifted(result, mul_limbs(slice_limbs(big, i, i + small.size()), small), i);
+        }
+        trim(result);
+        return result;
+    }
 
+    static uint32_t pow_mod(uint64_t base, uint64_t exp, uint32_t mod) {
+        uint64_t result = 1;
+        base %= mod;
+        while (exp) {
+            if (exp & 1) result = result * base % mod;
+            base = base * base % mod;
+            exp >>= 1;
+        }
+        return (uint32_t)result;
+    }
 
-        if (!num.empty() && num[0] == '-') {
-            is_negative = true;
-            num = num.substr(1);
+    // Transforms at least this long spread their loops over the thread pool,
+    // in chunks of PARALLEL_GRAIN elements.
+    static constexpr size_t PARALLEL_NTT_LENGTH = size_t(1) << 16;
+    static constexpr size_t PARALLEL_GRAIN = size_t(1) << 13;
+
+    // Calls body(lo, hi) on consecutive chunks covering [0, n).
+    template<typename F>
+    static void for_chunks(size_t n, bool parallel, F body) {
+        if (!parallel || n <= PARALLEL_GRAIN) {
+            body(0, n);
+            return;
         }
+        ThreadPool::instance().parallelFor((n + PARALLEL_GRAIN - 1) / PARALLEL_GRAIN, [&](size_t chunk) {
+            body(chunk * PARALLEL_GRAIN, min(n, (chunk + 1) * PARALLEL_GRAIN));
+        });
+    }
 
+    static size_t reverse_bits(size_t x, unsigned bits) {
+        size_t result = 0;
+        for (unsigned i = 0; i < bits; i++, x >>= 1)
+            result = (result << 1) | (x & 1);
+        return result;
+    }
 
-        size_t e_pos = num.find_first_of("eE");
-        string exp_str;
-        long long exponent = 0;
-        if (e_pos != string::npos) {
-            exp_str = num.substr(e_pos + 1);
-            num = num.substr(0, e_pos);
-            try {
-                exponent = atoll(exp_str.c_str());
-            } catch (...) {
-                throw invalid_argument("Invalid exponent: " + exp_str);
+    template<uint32_t MOD>
+    static void ntt(limb_vector& a, bool invert, bool parallel) {
+        size_t n = a.size();
+        unsigned log_n = 0;
+        while ((size_t(1) << log_n) < n) log_n++;
+
+        // Every pair is swapped by the chunk owning its smaller index.
+        for_chunks(n, parallel, [&](size_t lo, size_t hi) {
+            size_t j = reverse_bits(lo, log_n);
+            for (size_t i = lo; i < hi; i++) {
+                if (i < j)
+                    swap(a[i], a[j]);
+                size_t bit = n >> 1;
+                for (; j & bit; bit >>= 1)
+                    j ^= bit;
+                j ^= bit;
             }
+        });
+
+        limb_vector roots(n / 2);
+        for (size_t len = 2; len <= n; len <<= 1) {
+            size_t half = len / 2;
+            uint64_t wlen = pow_mod(3, (MOD - 1) / len, MOD);
+            if (invert) wlen = pow_mod(wlen, MOD - 2, MOD);
+            for_chunks(half, parallel, [&](size_t lo, size_t hi) {
+                uint64_t w = pow_mod(wlen, lo, MOD);
+                for (size_t j = lo; j < hi; j++, w = w * wlen % MOD)
+                    roots[j] = (uint32_t)w;
+            });
+            // Butterfly k is j = k mod half of the block starting at 2 * (k - j).
+            for_chunks(n / 2, parallel, [&, half](size_t lo, size_t hi) {
+                const uint32_t* w = roots.data();
+                for (size_t k = lo; k < hi;) {
+                    size_t j = k & (half - 1);
+                    uint32_t* x = a.data() + 2 * (k - j);
+                    uint32_t* y = x + half;
+                    size_t end = min(half, j + (hi - k));
+                    k += end - j;
+                    for (; j < end; j++) {
+                        uint32_t u = x[j];
+                        uint32_t v = (uint32_t)((uint64_t)y[j] * w[j] % MOD);
+                        x[j] = u + v < MOD ? u + v : u + v - MOD;
+                        y[j] = u >= v ? u - v : u + MOD - v;
+                    }
+                }
+            });
         }
 
+        if (invert) {
+            uint64_t n_inv = pow_mod(n, MOD - 2, MOD);
+            for_chunks(n, parallel, [&](size_t lo, size_t hi) {
+                for (size_t i = lo; i < hi; i++)
+                    a[i] = (uint32_t)(a[i] * n_inv % MOD);
+            });
+        }
+    }
 
-        size_t dot_pos = num.find('.');
-        string int_part = (dot_pos != string::npos) ? num.substr(0, dot_pos) : num;
-        string dec_part = (dot_pos != string::npos) ? num.substr(dot_pos + 1) : "";
+    template<uint32_t MOD>
+    static limb_vector convolve_mod(const limb_vector& a, const limb_vector& b, size_t n, bool parallel) {
+        limb_vector fa(n, 0), fb(n, 0);
+        for_chunks(a.size(), parallel, [&](size_t lo, size_t hi) {
+            for (size_t i = lo; i < hi; ++i) fa[i] = a[i] % MOD;
+        });
+        for_chunks(b.size(), parallel, [&](size_t lo, size_t hi) {
+            for (size_t i = lo; i < hi; ++i) fb[i] = b[i] % MOD;
+        });
+        ntt<MOD>(fa, false, parallel);
+        ntt<MOD>(fb, false, parallel);
+        for_chunks(n, parallel, [&](size_t lo, size_t hi) {
+            for (size_t i = lo; i < hi; ++i)
+                fa[i] = (uint32_t)((uint64_t)fa[i] * fb[i] % MOD);
+        });
+        ntt<MOD>(fa, true, parallel);
+        return fa;
+    }
 
+    // Exact convolution of whole limbs modulo three NTT primes, recombined
+    // with Garner's algorithm. Large products spread the transforms and the
+    // recombination over the thread pool.
+    static limb_vector mul_ntt(const limb_vector& a, const limb_vector& b) {
+        const uint32_t P1 = 998244353, P2 = 167772161, P3 = 469762049;
+        size_t n = 1;
+        while (n < a.size() + b.size()) n <<= 1;
+        bool parallel = n >= PARALLEL_NTT_LENGTH && ThreadPool::instance().threadCount() > 1;
+        limb_vector c1 = convolve_mod<P1>(a, b, n, parallel);
+        limb_vector c2 = convolve_mod<P2>(a, b, n, parallel);
+        limb_vector c3 = convolve_mod<P3>(a, b, n, parallel);
+
+        const uint64_t inv_p1_p2 = pow_mod(P1, P2 - 2, P2);
+        const uint64_t inv_p1p2_p3 = pow_mod((uint64_t)P1 * P2 % P3, P3 - 2, P3);
+
+        // Each chunk recombines and carries its own limbs; the carries out of
+        // the chunks are then added in serially.
+        limb_vector result(a.size() + b.size(), 0);
+        vector<uint64_t> chunk_carry(result.size() / PARALLEL_GRAIN + 1, 0);
+        for_chunks(result.size(), parallel, [&](size_t lo, size_t hi) {
+            unsigned __int128 carry = 0;
+            for (size_t i = lo; i < hi; ++i) {
+                uint64_t v1 = c1[i];
+                uint64_t v2 = (c2[i] + P2 - v1 % P2) % P2 * inv_p1_p2 % P2;
+                uint64_t low = (v1 + v2 % P3 * P1) % P3;
+                uint64_t v3 = (c3[i] + P3 - low) % P3 * inv_p1p2_p3 % P3;
+                carry += (unsigned __int128)v3 * P1 * P2 + (unsigned __int128)v2 * P1 + v1;
+                result[i] = (uint32_t)carry;
+                carry >>= 32;
+            }
+            chunk_carry[lo / PARALLEL_GRAIN] = (uint64_t)carry;
+        });
+
+        for (size_t lo = 0; lo < result.size(); lo += PARALLEL_GRAIN) {
+            uint64_t add = chunk_carry[lo / PARALLEL_GRAIN];
+            for (size_t i = lo + PARALLEL_GRAIN; add && i < result.size(); ++i) {
+                uint64_t sum = (uint64_t)result[i] + (uint32_t)add;
+                result[i] = (uint32_t)sum;
+                add = (add >> 32) + (sum >> 32);
+            }
+        }
+        trim(result);
+        return result;
+    }
 
-        string digits = int_part + dec_part;
-        int original_dot_pos = int_part.size();
+    static limb_vector mul_limbs(const limb_vector& a, const limb_vector& b) {
+        const limb_vector& big = a.size() >= b.size() ? a : b;
+        const limb_vector& small = a.size() >= b.size() ? b : a;
+        if (small.size() < KARATSUBA_THRESHOLD)
+            return mul_schoolbook(big, small);
+        if (small.size() >= NTT_THRESHOLD && big.size() + small.size() <= NTT_MAX_LENGTH)
+            return mul_ntt(big, small);
+        if (2 * small.size() <= big.size())
+            return mul_unbalanced(big, small);
+        if (small.size() < TOOM3_THRESHOLD)
+            return mul_karatsuba(big, small);
+        return mul_toom3(big, small);
+    }
 
+    // Divisors (and quotients) at least this many limbs long use Newton
+    // reciprocal division instead of Knuth D; reciprocals shorter than
+    // RECIPROCAL_BASE limbs are computed directly with Knuth D.
+    static constexpr size_t NEWTON_DIVISION_THRESHOLD = 5000;
+    static constexpr size_t RECIPROCAL_BASE = 160;
+
+    static limb_vector shift_bits_left(const limb_vector& a, unsigned s) {
+        limb_vector result(a.size() + 1, 0);
+        for (size_t i = 0; i < a.size(); ++i) {
+            result[i] |= a[i] << s;
+            if (s) result[i + 1] = a[i] >> (32 - s);
+        }
+        trim(result);
+        return result;
+    }
 
-        long long new_dot_pos = original_dot_pos + exponent;
+    static limb_vector shift_bits_right(const limb_vector& a, unsigned s) {
+        limb_vector result(a.size(), 0);
+        for (size_t i = 0; i < a.size(); ++i) {
+            result[i] = a[i] >> s;
+            if (s && i + 1 < a.size()) result[i] |= a[i + 1] << (32 - s);
+        }
+        trim(result);
+        return result;
+    }
 
+    // Knuth, TAOCP vol. 2, 4.3.1, algorithm D. Requires b.size() >= 2.
+    static limb_vector divmod_knuth(const limb_vector& a, const limb_vector& b, limb_vector& remainder) {
+        size_t n = b.size(), m = a.size() - n;
+        unsigned s = __builtin_clz(b.back());
+        limb_vector vn = shift_bits_left(b, s);
+        limb_vector un = shift_bits_left(a, s);
+        un.resize(a.size() + 1, 0);
+
+        limb_vector quotient(m + 1, 0);
+        for (size_t j = m + 1; j-- > 0;) {
+            uint64_t num = ((uint64_t)un[j + n] << 32) | un[j + n - 1];
+            uint64_t qhat = num / vn[n - 1];
+            uint64_t rhat = num % vn[n - 1];
+            while (qhat >> 32 || qhat * vn[n - 2] > ((rhat << 32) | un[j + n - 2])) {
+                qhat--;
+                rhat += vn[n - 1];
+                if (rhat >> 32) break;
+            }
 
-        string new_int_part, new_dec_part;
-        if (new_dot_pos >= 0) {
-            if (new_dot_pos <= digits.size()) {
-                new_int_part = digits.substr(0, new_dot_pos);
-                new_dec_part = digits.substr(new_dot_pos);
-            } else {
-                new_int_part = digits + string(new_dot_pos - digits.size(), '0');
+            int64_t borrow = 0;
+            for (size_t i = 0; i < n; ++i) {
+                uint64_t p = qhat * vn[i];
+                int64_t t = (int64_t)un[i + j] - borrow - (int64_t)(p & 0xFFFFFFFF);
+                un[i + j] = (uint32_t)t;
+                borrow = (int64_t)(p >> 32) - (t >> 32);
             }
-        } else {
-            new_int_part = "0";
-            new_dec_part = string(-new_dot_pos, '0') + digits;
+            int64_t t = (int64_t)un[j + n] - borrow;
+            un[j + n] = (uint32_t)t;
+
+            if (t < 0) {
+                qhat--;
+                uint64_t carry = 0;
+                for (size_t i = 0; i < n; ++i) {
+                    uint64_t sum = (uint64_t)un[i + j] + vn[i] + carry;
+                    un[i + j] = (uint32_t)sum;
+                    carry = sum >> 32;
+                }
+                un[j + n] += (uint32_t)carry;
+            }
+            quotient[j] = (uint32_t)qhat;
         }
 
+        un.resize(n);
+        trim(un);
+        remainder = shift_bits_right(un, s);
+        trim(quotient);
+        return quotient;
+    }
 
-        if (new_int_part.empty()) new_int_part = "0";
-        new_int_part.erase(0, min(new_int_part.find_first_not_of('0'), new_int_part.size()-1));
+    // floor((B^(2L) - 1) / d) for a normalized d of L limbs, B = 2^32.
+    // Newton iteration on the top half of d, then corrected exactly.
+    static limb_vector reciprocal(const limb_vector& d) {
+        size_t len = d.size();
+        if (len < RECIPROCAL_BASE) {
+            limb_vector remainder;
+            return divmod_knuth(limb_vector(2 * len, 0xFFFFFFFF), d, remainder);
+        }
 
+        size_t h = (len + 1) / 2;
+        limb_vector x = reciprocal(slice_limbs(d, len - h, len));
+        x.insert(x.begin(), len - h, 0);
+
+        limb_vector power(2 * len + 1, 0);
+        power.back() = 1;
+        SignedLimbs error = signed_sub({power, false}, {mul_limbs(d, x), false});
+        limb_vector correction = slice_limbs(mul_limbs(x, error.mag), 2 * len, SIZE_MAX);
+        x = error.neg ? sub_limbs(x, correction) : add_limbs(x, correction);
+
+        power.assign(2 * len, 0xFFFFFFFF);
+        SignedLimbs rest = signed_sub({power, false}, {mul_limbs(d, x), false});
+        const limb_vector one(1, 1);
+        while (rest.neg && !(rest.mag.size() == 1 && rest.mag[0] == 0)) {
+            x = sub_limbs(x, one);
+            rest = signed_add(rest, {d, false});
+        }
+        while (compare_limbs(rest.mag, d) >= 0) {
+            x = add_limbs(x, one);
+            rest.mag = sub_limbs(rest.mag, d);
+        }
+        return x;
+    }
 
-        new_dec_part.resize(DECIMAL_LIMIT, '0');
+    // Barrett-style division by a normalized d, one d-sized block of the
+    // dividend at a time, with the quotient block estimated from the
+    // Newton reciprocal and fixed up by at most a few subtractions.
+    static limb_vector divmod_newton(const limb_vector& a, const limb_vector& b, limb_vector& remainder) {
+        unsigned s = __builtin_clz(b.back());
+        limb_vector d = shift_bits_left(b, s);
+        limb_vector u = shift_bits_left(a, s);
+        limb_vector x = reciprocal(d);
+        size_t len = d.size();
+        const limb_vector one(1, 1);
+
+        limb_vector quotient(u.size() + len, 0);
+        limb_vector rest(1, 0);
+        for (size_t block = (u.size() + len - 1) / len; block-- > 0;) {
+            limb_vector t = slice_limbs(u, block * len, (block + 1) * len);
+            add_shifted(t, rest, len);
+            trim(t);
+
+            limb_vector q = slice_limbs(mul_limbs(t, x), 2 * len, SIZE_MAX);
+            limb_vector product = mul_limbs(q, d);
+            while (compare_limbs(product, t) > 0) {
+                q = sub_limbs(q, one);
+                product = sub_limbs(product, d);
+            }
+            rest = sub_limbs(t, product);
+            while (compare_limbs(rest, d) >= 0) {
+                q = add_limbs(q, one);
+                rest = sub_limbs(rest, d);
+            }
+            for (size_t i = 0; i < q.size() && block * len + i < quotient.size(); ++i)
+                quotient[block * len + i] = q[i];
+        }
 
+        remainder = shift_bits_right(rest, s);
+        trim(quotient);
+        return quotient;
+    }
 
-        integer.resize(new_int_part.size());
-        transform(new_int_part.rbegin(), new_int_part.rend(), integer.begin(),
-                  [](char c) { return c - '0'; });
+    static limb_vector divmod_limbs(const limb_vector& a, const limb_vector& b, limb_vector& remainder) {
+        if (compare_limbs(a, b) < 0) {
+            remainder = a;
+            return limb_vector(1, 0);
+        }
+        if (b.size() == 1) {
+            limb_vector quotient = a;
+            remainder.assign(1, divmod_small(quotient, b[0]));
+            return quotient;
+        }
+        if (b.size() >= NEWTON_DIVISION_THRESHOLD && a.size() - b.size() >= NEWTON_DIVISION_THRESHOLD)
+            return divmod_newton(a, b, remainder);
+        return divmod_knuth(a, b, remainder);
+    }
 
+    static size_t bit_length(const limb_vector& a) {
+        if (a.back() == 0) return 0;
+        return (a.size() - 1) * 32 + (32 - __builtin_clz(a.back()));
+    }
 
-        decimal.resize(DECIMAL_LIMIT);
-        transform(new_dec_part.begin(),
-                  new_dec_part.begin() + DECIMAL_LIMIT,
-                  decimal.begin(),
-                  [](char c) { return c - '0'; });
+    static bool test_bit(const limb_vector& a, size_t bit) {
+        return (a[bit / 32] >> (bit % 32)) & 1;
+    }
 
-        normalize();
+    // Newton iteration from a power of two above the root; stops at the
+    // first non-decreasing step, which is floor(sqrt(n)).
+    static limb_vector isqrt_limbs(const limb_vector& n) {
+        if (n.size() == 1 && n[0] < 2) return n;
+        size_t bits = (bit_length(n) + 1) / 2;
+        limb_vector x(bits / 32 + 1, 0);
+        x[bits / 32] = 1u << (bits % 32);
+        limb_vector remainder;
+        while (true) {
+            limb_vector y = add_limbs(x, divmod_limbs(n, x, remainder));
+            y = shift_bits_right(y, 1);
+            if (compare_limbs(y, x) >= 0) return x;
+            x = y;
+        }
     }
 
+    // Montgomery multiplication modulo an odd m, R = 2^(32 * m.size()).
+    struct Montgomery {
+        limb_vector m;
+        uint32_t m_inv;
+        limb_vector r2;
+
+        explicit Montgomery(const limb_vector& modulus) : m(modulus) {
+            uint32_t inv = 1;
+            for (int i = 0; i < 5; ++i)
+                inv *= 2 - m[0] * inv;
+            m_inv = -inv;
+            limb_vector power(2 * m.size() + 1, 0);
+            power.back() = 1;
+            divmod_limbs(power, m, r2);
+        }
 
-    long long get_ll() const {
-        constexpr long long LL_MAX = std::numeric_limits<long long>::max();
-        constexpr long long LL_MIN = std::numeric_limits<long long>::min();
+        // CIOS: a * b * R^-1 mod m for a, b < m.
+        limb_vector mul(limb_vector a, limb_vector b) const {
+            size_t n = m.size();
+            a.resize(n, 0);
+            b.resize(n, 0);
+            limb_vector t(n + 2, 0);
+            for (size_t i = 0; i < n; ++i) {
+                uint64_t bi = b[i];
+                uint64_t carry = 0;
+                for (size_t j = 0; j < n; ++j) {
+                    uint64_t cur = (uint64_t)t[j] + a[j] * bi + carry;
+                    t[j] = (uint32_t)cur;
+                    carry = cur >> 32;
+                }
+                uint64_t cur = (uint64_t)t[n] + carry;
+                t[n] = (uint32_t)cur;
+                t[n + 1] = (uint32_t)(cur >> 32);
+
+                uint64_t factor = (uint32_t)(t[0] * m_inv);
+                carry = ((uint64_t)t[0] + factor * m[0]) >> 32;
+                for (size_t j = 1; j < n; ++j) {
+                    cur = (uint64_t)t[j] + factor * m[j] + carry;
+                    t[j - 1] = (uint32_t)cur;
+                    carry = cur >> 32;
+                }
+                cur = (uint64_t)t[n] + carry;
+                t[n - 1] = (uint32_t)cur;
+                t[n] = t[n + 1] + (uint32_t)(cur >> 32);
+            }
+            t.pop_back();
+            trim(t);
+            if (compare_limbs(t, m) >= 0) t = sub_limbs(t, m);
+            return t;
+        }
 
+        limb_vector to_form(const limb_vector& a) const { return mul(a, r2); }
+        limb_vector from_form(const limb_vector& a) const { return mul(a, limb_vector(1, 1)); }
+    };
 
-        const bool is_neg = is_negative && !is_zero();
-        long long result = 0;
+    // Barrett reduction of x < m^2 modulo m, mu = floor(B^(2k) / m).
+    struct Barrett {
+        limb_vector m;
+        limb_vector mu;
 
+        explicit Barrett(const limb_vector& modulus) : m(modulus) {
+            limb_vector power(2 * m.size() + 1, 0), remainder;
+            power.back() = 1;
+            mu = divmod_limbs(power, m, remainder);
+        }
 
-        for (auto it = integer.rbegin(); it != integer.rend(); ++it) {
-            int digit = *it;
+        limb_vector reduce(const limb_vector& x) const {
+            size_t k = m.size();
+            limb_vector q = slice_limbs(x, k - 1, SIZE_MAX);
+            q = slice_limbs(mul_limbs(q, mu), k + 1, SIZE_MAX);
+            limb_vector product = mul_limbs(q, m);
+            limb_vector r = compare_limbs(x, product) >= 0 ? sub_limbs(x, product) : limb_vector(1, 0);
+            while (compare_limbs(r, m) >= 0)
+                r = sub_limbs(r, m);
+            return r;
+        }
+    };
+
+    // (a >> shift) mod 2^64.
+    static uint64_t bits_at(const limb_vector& a, size_t shift) {
+        size_t limb = shift / 32;
+        unsigned __int128 window = 0;
+        for (size_t i = min(a.size(), limb + 3); i-- > limb;)
+            window = (window << 32) | a[i];
+        return (uint64_t)(window >> (shift % 32));
+    }
 
+    // Lehmer's gcd for a >= b, after CPython's long gcd: Euclid runs on the
+    // leading 62 bits while the quotients provably match the full ones,
+    // and the collected cofactors are then applied to a and b at once.
+    // If t0 and t1 are given they follow the same steps, so that with
+    // a = t0 x and b = t1 x (mod m) on entry the result is t0 x mod m.
+    static limb_vector gcd_limbs(limb_vector a, limb_vector b, SignedLimbs* t0 = nullptr, SignedLimbs* t1 = nullptr) {
+        auto combine = [](const auto& x, uint64_t p, const auto& y, uint64_t q) {
+            return signed_sub(signed_mul(x, {limbs_of(p), false}), signed_mul(y, {limbs_of(q), false}));
+        };
+        while (!limbs_zero(b)) {
+            size_t length = bit_length(a);
+            if (length > 64) {
+                size_t shift = length - 62;
+                int64_t x = bits_at(a, shift), y = bits_at(b, shift);
+                int64_t A = 1, B = 0, C = 0, D = 1;
+                int k = 0;
+                for (;; ++k) {
+                    if (y - C == 0) break;
+                    int64_t q = (x + (A - 1)) / (y - C);
+                    int64_t s = B + q * D;
+                    int64_t t = x - q * y;
+                    if (s > t) break;
+                    x = y;
+                    y = t;
+                    t = A + q * C;
+                    A = D;
+                    B = C;
+                    C = s;
+                    D = t;
+                }
+                if (k > 0) {
+                    SignedLimbs sa = {a, false}, sb = {b, false};
+                    if (k & 1) {
+                        a = combine(sb, A, sa, B).mag;
+                        b = combine(sa, D, sb, C).mag;
+                    } else {
+                        a = combine(sa, A, sb, B).mag;
+                        b = combine(sb, D, sa, C).mag;
+                    }
+                    if (t0) {
+                        SignedLimbs u = *t0, v = *t1;
+                        *t0 = k & 1 ? combine(v, A, u, B) : combine(u, A, v, B);
+                        *t1 = k & 1 ? combine(u, D, v, C) : combine(v, D, u, C);
+                    }
+                    continue;
+                }
+            }
 
-            if (!is_neg) {
-                if (result > LL_MAX / 10) return LL_MAX;
-                result *= 10;
-                if (result > LL_MAX - digit) return LL_MAX;
-                result += digit;
+            limb_vector remainder;
+            limb_vector q = divmod_limbs(a, b, remainder);
+            if (t0) {
+                SignedLimbs next = signed_sub(*t0, signed_mul({q, false}, *t1));
+                *t0 = *t1;
+                *t1 = next;
             }
+            a.swap(b);
+            b.swap(remainder);
+        }
+        return a;
+    }
 
-            else {
-                if (result < LL_MIN / 10) return LL_MIN;
-                result *= 10;
-                if (result < LL_MIN + digit) return LL_MIN;
-                result -= digit;
+    // base^exponent in Montgomery form, for base < m; a fixed 4-bit window
+    // costs one table multiply per four squarings.
+    static limb_vector mont_pow(const Montgomery& mont, const limb_vector& base, const limb_vector& exponent) {
+        vector<limb_vector> table(16);
+        table[0] = mont.to_form(limb_vector(1, 1));
+        table[1] = mont.to_form(base);
+        for (int i = 2; i < 16; ++i)
+            table[i] = mont.mul(table[i - 1], table[1]);
+
+        limb_vector acc = table[0];
+        size_t bits = bit_length(exponent);
+        for (size_t top = (bits + 3) / 4 * 4; top > 0; top -= 4) {
+            int window = 0;
+            for (size_t bit = top; bit-- > top - 4;) {
+                acc = mont.mul(acc, acc);
+                window = window * 2 + (bit < bits && test_bit(exponent, bit));
             }
+            if (window) acc = mont.mul(acc, table[window]);
         }
+        return acc;
+    }
 
-        return result;
+    static uint64_t mul_mod64(uint64_t a, uint64_t b, uint64_t m) {
+        return (uint64_t)((unsigned __int128)a * b % m);
     }
 
-    template<typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
-    BigNum(T value) {
-        if constexpr (std::is_integral<T>::value) {
+    // Strong probable prime test of an odd n > 2 to one base.
+    static bool miller_rabin64(uint64_t n, uint64_t base) {
+        uint64_t d = n - 1;
+        int s = __builtin_ctzll(d);
+        d >>= s;
+        uint64_t x = 1, power = base % n;
+        for (; d; d >>= 1) {
+            if (d & 1) x = mul_mod64(x, power, n);
+            power = mul_mod64(power, power, n);
+        }
+        if (x == 1 || x == n - 1) return true;
+        while (--s > 0) {
+            x = mul_mod64(x, x, n);
+            if (x == n - 1) return true;
+        }
+        return false;
+    }
 
-            *this = BigNum(std::to_string(value));
-        } else {
+    static bool miller_rabin(const Montgomery& mont, const limb_vector& n, const limb_vector& base) {
+        limb_vector n_minus_1 = sub_limbs(n, limb_vector(1, 1));
+        size_t s = 0;
+        while (!test_bit(n_minus_1, s)) ++s;
+        limb_vector one = mont.to_form(limb_vector(1, 1));
+        limb_vector minus_one = mont.to_form(n_minus_1);
+
+        limb_vector x = mont_pow(mont, base, shift_right(n_minus_1, s));
+        if (x == one || x == minus_one) return true;
+        while (--s > 0) {
+            x = mont.mul(x, x);
+            if (x == minus_one) return true;
+        }
+        return false;
+    }
 
-            std::ostringstream oss;
-            oss << std::fixed << std::setprecision(340) << value;
-            std::string s = oss.str();
+    // The first 13 prime bases decide every n < 3.3 * 10^24; larger n get
+    // MILLER_RABIN_ROUNDS further bases from a fixed-seed generator.
+    static constexpr int MILLER_RABIN_ROUNDS = 12;
 
+    // Below these sizes radix conversion uses the quadratic 10^9 chunk loop.
+    static constexpr size_t TO_STRING_BASE_LIMBS = 40;
+    static constexpr size_t PARSE_BASE_DIGITS = 400;
 
-            size_t dot_pos = s.find('.');
-            if (dot_pos != std::string::npos) {
-                s.erase(s.find_last_not_of('0') + 1, std::string::npos);
-                if (s.back() == '.') s.pop_back();
+    // 10^(9 * 2^k), shared by the divide-and-conquer conversions.
+    static const limb_vector& decimal_power(size_t k) {
+        static deque<limb_vector> powers(1, limb_vector(1, 1000000000));
+        while (powers.size() <= k)
+            powers.push_back(mul_limbs(powers.back(), powers.back()));
+        return powers[k];
+    }
+
+    // Appends value in decimal, zero-padded on the left to width digits.
+    static void append_decimal(const limb_vector& value, size_t width, string& out) {
+        if (value.size() <= TO_STRING_BASE_LIMBS) {
+            limb_vector rest = value;
+            limb_vector chunks;
+            do {
+                chunks.push_back(divmod_small(rest, 1000000000));
+            } while (rest.size() > 1 || rest[0] != 0);
+
+            string digits = std::to_string(chunks.back());
+            for (size_t i = chunks.size() - 1; i-- > 0;) {
+                string chunk = std::to_string(chunks[i]);
+                digits += string(9 - chunk.size(), '0') + chunk;
             }
-            *this = BigNum(s);
+            if (digits.size() < width) out.append(width - digits.size(), '0');
+            out += digits;
+            return;
         }
+
+        size_t k = 0;
+        while (decimal_power(k + 1).size() * 2 <= value.size() + 1) ++k;
+        size_t low_width = (size_t)9 << k;
+        limb_vector low;
+        limb_vector high = divmod_limbs(value, decimal_power(k), low);
+        append_decimal(high, width > low_width ? width - low_width : 0, out);
+        append_decimal(low, low_width, out);
     }
 
+    static limb_vector parse_decimal(const char* digits, size_t len) {
+        if (len <= PARSE_BASE_DIGITS) {
+            limb_vector result(1, 0);
+            for (size_t i = 0; i < len; i += 9) {
+                size_t chunk_len = min<size_t>(9, len - i);
+                uint32_t chunk = 0;
+                for (size_t j = i; j < i + chunk_len; ++j)
+                    chunk = chunk * 10 + (digits[j] - '0');
+                mul_small_add(result, pow10_small(chunk_len), chunk);
+            }
+            return result;
+        }
 
-    bool operator<(const BigNum& rhs) const {
-        if (is_negative != rhs.is_negative)
-            return is_negative;
+        size_t k = 0;
+        while (((size_t)9 << (k + 1)) < len) ++k;
+        size_t low_len = (size_t)9 << k;
+        limb_vector result = mul_limbs(parse_decimal(digits, len - low_len), decimal_power(k));
+        return add_limbs(result, parse_decimal(digits + len - low_len, low_len));
+    }
 
-        int cmp = compare_abs(rhs);
-        return is_negative ? (cmp == 1) : (cmp == -1);
+    static uint32_t pow10_small(int n) {
+        uint32_t result = 1;
+        while (n-- > 0) result *= 10;
+        return result;
     }
 
-    bool operator==(const BigNum& rhs) const {
-        return is_negative == rhs.is_negative &&
-               integer == rhs.integer &&
-               decimal == rhs.decimal;
+    static limb_vector mul_pow10(limb_vector a, int n) {
+        for (; n > 0; n -= 9)
+            mul_small_add(a, pow10_small(min(n, 9)), 0);
+        return a;
     }
 
-    bool operator!=(const BigNum& rhs) const { return !(*this == rhs); }
-    bool operator>(const BigNum& rhs) const { return rhs < *this; }
-    bool operator<=(const BigNum& rhs) const { return !(rhs < *this); }
-    bool operator>=(const BigNum& rhs) const { return !(*this < rhs); }
+    static limb_vector div_pow10(limb_vector a, int n) {
+        for (; n > 0; n -= 9)
+            divmod_small(a, pow10_small(min(n, 9)));
+        return a;
+    }
 
-    BigNum operator+(const BigNum& rhs) const {
-        if (is_negative != rhs.is_negative) {
-            BigNum tmp = rhs;
-            tmp.is_negative = !tmp.is_negative;
-            return *this - tmp;
+    static limb_vector limbs_of(uint64_t value) {
+        limb_vector result(1, (uint32_t)value);
+        if (value >> 32) result.push_back((uint32_t)(value >> 32));
+        return result;
+    }
+
+    template<typename T>
+    static uint64_t magnitude_of(T value) {
+        if constexpr (std::is_signed<T>::value) {
+            if (value < 0) return 0ull - (uint64_t)value;
         }
+        return (uint64_t)value;
+    }
 
-        BigNum result;
-        result.is_negative = is_negative;
-
-
-        int max_int = max(integer.size(), rhs.integer.size());
-        result.integer.resize(max_int);
-        int carry = 0;
-        for (int i = 0; i < max_int; ++i) {
-            int a = (i < integer.size()) ? integer[i] : 0;
-            int b = (i < rhs.integer.size()) ? rhs.integer[i] : 0;
-            int sum = a + b + carry;
-            result.integer[i] = sum % 10;
-            carry = sum / 10;
-        }
-        if (carry) result.integer.push_back(carry);
-
-
-        int max_dec = max(decimal.size(), rhs.decimal.size());
-        result.decimal.resize(max_dec);
-        carry = 0;
-        for (int i = max_dec-1; i >= 0; --i) {
-            int a = (i < decimal.size()) ? decimal[i] : 0;
-            int b = (i < rhs.decimal.size()) ? rhs.decimal[i] : 0;
-            int sum = a + b + carry;
-            result.decimal[i] = sum % 10;
-            carry = sum / 10;
-        }
-        if (carry) {
-            result.integer[0] += carry;
-            int i = 0;
-            while (result.integer[i] >= 10) {
-                if (i+1 >= result.integer.size()) result.integer.push_back(0);
-                result.integer[i+1] += result.integer[i] / 10;
-                result.integer[i] %= 10;
-                ++i;
-            }
+    static limb_vector limbs_from_digits(const string& digits) {
+        if (digits.size() <= 19) {
+            uint64_t value = 0;
+            for (char c : digits)
+                value = value * 10 + (c - '0');
+            return limbs_of(value);
         }
+        return parse_decimal(digits.data(), digits.size());
+    }
 
-        result.normalize();
+    static string digits_from_limbs(const limb_vector& a) {
+        if (a.size() <= 2)
+            return std::to_string(a[0] | (a.size() > 1 ? (uint64_t)a[1] << 32 : 0));
+        string result;
+        append_decimal(a, 0, result);
         return result;
     }
 
-    BigNum operator-(const BigNum& rhs) const {
-        if (is_negative != rhs.is_negative) {
-            BigNum tmp = rhs;
-            tmp.is_negative = !tmp.is_negative;
-            return *this + tmp;
+    // mantissa rescaled to `to` fractional digits (to >= scale).
+    limb_vector aligned(int to) const {
+        return to == scale ? mantissa : mul_pow10(mantissa, to - scale);
+    }
+
+    bool is_zero() const {
+        return mantissa.size() == 1 && mantissa[0] == 0;
+    }
+
+    // Cuts the fraction to the current precision (truncating) and drops
+    // trailing fractional zeros, so equal values have equal fields.
+    void normalize() {
+        trim(mantissa);
+        if (scale > current_precision) {
+            mantissa = div_pow10(mantissa, scale - current_precision);
+            scale = current_precision;
         }
+        strip_zeros();
+    }
 
-        if (abs() < rhs.abs()) {
-            BigNum result = rhs - *this;
-            result.is_negative = !is_negative;
-            return result;
+    void strip_zeros() {
+        while (scale > 0) {
+            limb_vector rest = mantissa;
+            if (divmod_small(rest, 10) != 0) break;
+            mantissa.swap(rest);
+            --scale;
+        }
+        if (is_zero()) {
+            is_negative = false;
+            scale = 0;
         }
+    }
 
+    static BigNum make(limb_vector mantissa, int scale, bool negative) {
         BigNum result;
-        result.is_negative = is_negative;
-
-
-        result.integer = integer;
-        int borrow = 0;
-        for (size_t i = 0; i < result.integer.size(); ++i) {
-            int sub = (i < rhs.integer.size()) ? rhs.integer[i] : 0;
-            result.integer[i] -= sub + borrow;
-            borrow = 0;
-            if (result.integer[i] < 0) {
-                result.integer[i] += 10;
-                borrow = 1;
-            }
-        }
+        result.mantissa = std::move(mantissa);
+        result.scale = scale;
+        result.is_negative = negative;
+        result.normalize();
+        return result;
+    }
 
+    // The elementary functions work in binary fixed point: a SignedLimbs x
+    // with `bits` fractional bits stands for x.mag / 2^bits. Results carry
+    // GUARD_BITS beyond the requested digits, so the decimal result is
+    // correct to within one unit in its last place.
+    static constexpr size_t GUARD_BITS = 64;
+    static constexpr size_t BIT_BURST_FIRST = 8;
+    static constexpr double EXP_MAX_ARGUMENT = 1e8;
 
-        int max_dec = max(decimal.size(), rhs.decimal.size());
-        result.decimal.resize(max_dec);
-        borrow = 0;
-        for (int i = max_dec-1; i >= 0; --i) {
-            int a = (i < decimal.size()) ? decimal[i] : 0;
-            int b = (i < rhs.decimal.size()) ? rhs.decimal[i] : 0;
-            int diff = a - b - borrow;
-            borrow = 0;
-            if (diff < 0) {
-                diff += 10;
-                borrow = 1;
-            }
-            result.decimal[i] = diff;
-        }
+    static size_t bits_for_digits(int digits) {
+        return (size_t)std::ceil(digits * 3.3219280948873623) + GUARD_BITS;
+    }
 
+    static bool limbs_zero(const limb_vector& a) {
+        return a.size() == 1 && a[0] == 0;
+    }
 
-        if (borrow) {
-            for (size_t i = 0; i < result.integer.size(); ++i) {
-                if (result.integer[i] > 0) {
-                    result.integer[i]--;
-                    break;
-                } else {
-                    result.integer[i] = 9;
-                }
-            }
-        }
+    static limb_vector shift_left(const limb_vector& a, size_t bits) {
+        if (limbs_zero(a)) return a;
+        limb_vector result = shift_bits_left(a, bits % 32);
+        result.insert(result.begin(), bits / 32, 0);
+        return result;
+    }
 
-        result.normalize();
+    static limb_vector shift_right(const limb_vector& a, size_t bits) {
+        if (bits / 32 >= a.size()) return limb_vector(1, 0);
+        return shift_bits_right(slice_limbs(a, bits / 32, a.size()), bits % 32);
+    }
+
+    // a mod 2^bits
+    static limb_vector low_bits(const limb_vector& a, size_t bits) {
+        limb_vector result = slice_limbs(a, 0, (bits + 31) / 32);
+        if (bits % 32 && result.size() == (bits + 31) / 32)
+            result.back() &= (1u << (bits % 32)) - 1;
+        trim(result);
         return result;
     }
 
-    BigNum operator*(const BigNum& rhs) const {
-        if (*this == 0 || rhs == 0) return BigNum();
+    static limb_vector pow10_limbs(size_t n) {
+        limb_vector result(1, 1), base(1, 10);
+        for (; n; n >>= 1) {
+            if (n & 1) result = mul_limbs(result, base);
+            if (n > 1) base = mul_limbs(base, base);
+        }
+        return result;
+    }
 
+    static limb_vector fixed_one(size_t bits) {
+        return shift_left(limb_vector(1, 1), bits);
+    }
 
-        auto extend_num = [](const BigNum& num) {
-            vector<int> v = num.decimal;
-            reverse(v.begin(), v.end());
-            v.insert(v.end(), num.integer.begin(), num.integer.end());
-            return v;
-        };
+    static SignedLimbs fixed_mul(const SignedLimbs& a, const SignedLimbs& b, size_t bits) {
+        return {shift_right(mul_limbs(a.mag, b.mag), bits), a.neg != b.neg};
+    }
 
-        vector<int> a = extend_num(*this);
-        vector<int> b = extend_num(rhs);
+    static SignedLimbs fixed_div(const SignedLimbs& a, const SignedLimbs& b, size_t bits) {
+        limb_vector remainder;
+        return {divmod_limbs(shift_left(a.mag, bits), b.mag, remainder), a.neg != b.neg};
+    }
 
+    // num / (den * 2^den_shift) in fixed point.
+    static limb_vector fixed_ratio(const limb_vector& num, const limb_vector& den, size_t den_shift, size_t bits) {
+        limb_vector remainder;
+        if (bits >= den_shift) return divmod_limbs(shift_left(num, bits - den_shift), den, remainder);
+        return divmod_limbs(num, shift_left(den, den_shift - bits), remainder);
+    }
 
-        size_t n = 1;
-        while (n < a.size() + b.size()) n <<= 1;
-        vector<complex<double>> fa(n), fb(n);
+    static SignedLimbs fixed_of(double value, size_t bits) {
+        int exponent;
+        double fraction = std::frexp(std::fabs(value), &exponent);
+        limb_vector m = limbs_of((uint64_t)std::ldexp(fraction, 53));
+        long shift = (long)bits + exponent - 53;
+        return {shift >= 0 ? shift_left(m, shift) : shift_right(m, -shift), value < 0};
+    }
+
+    // *this truncated to `bits` fractional bits.
+    SignedLimbs to_fixed(size_t bits) const {
+        limb_vector remainder;
+        limb_vector shifted = shift_left(mantissa, bits);
+        if (scale == 0) return {shifted, is_negative};
+        return {divmod_limbs(shifted, pow10_limbs(scale), remainder), is_negative};
+    }
+
+    // x truncated to `digits` fractional digits. Unlike make(), does not
+    // cut the result to the current precision.
+    static BigNum from_fixed(const SignedLimbs& x, size_t bits, int digits) {
+        BigNum result;
+        result.mantissa = shift_right(mul_limbs(x.mag, pow10_limbs(digits)), bits);
+        result.scale = digits;
+        result.is_negative = x.neg;
+        result.strip_zeros();
+        return result;
+    }
+
+    // Natural log of the magnitude, good to about 40 bits; starts the
+    // Newton iterations and sizes the working precision.
+    double approx_log() const {
+        size_t length = bit_length(mantissa);
+        size_t dropped = length > 64 ? length - 64 : 0;
+        limb_vector top = shift_right(mantissa, dropped);
+        uint64_t lead = top[0] | (top.size() > 1 ? (uint64_t)top[1] << 32 : 0);
+        return std::log((double)lead) + dropped * M_LN2 - scale * M_LN10;
+    }
 
-        copy(a.begin(), a.end(), fa.begin());
-        copy(b.begin(), b.end(), fb.begin());
+    // Working precisions for an iteration that triples the correct bits per
+    // step, starting from a double estimate.
+    static vector<size_t> precision_steps(size_t bits) {
+        vector<size_t> steps(1, bits);
+        while (steps.back() > 60)
+            steps.push_back(steps.back() / 3 + 32);
+        reverse(steps.begin(), steps.end());
+        return steps;
+    }
+
+    // Binary splitting of sum_{k=a}^{b-1} c(k) prod_{j=a}^{k} p(j) / (q(j) 2^s(j)).
+    // term(k) returns p(k), q(k), s(k) and t = c(k) p(k); a range returns
+    // P = prod p, Q = prod q, S = sum s and T with sum = T / (Q 2^S).
+    // P of the outermost range is not needed, so with_p skips it.
+    struct Series {
+        SignedLimbs p;
+        limb_vector q;
+        size_t s;
+        SignedLimbs t;
+    };
+
+    template<typename Term>
+    static Series split(size_t a, size_t b, const Term& term, bool with_p = true) {
+        if (b - a == 1) return term(a);
+        size_t m = a + (b - a) / 2;
+        Series left = split(a, m, term, true);
+        Series right = split(m, b, term, with_p);
+
+        Series result;
+        SignedLimbs t1 = signed_mul(left.t, {right.q, false});
+        t1.mag = shift_left(t1.mag, right.s);
+        result.t = signed_add(t1, signed_mul(left.p, right.t));
+        if (with_p) result.p = signed_mul(left.p, right.p);
+        result.q = mul_limbs(left.q, right.q);
+        result.s = left.s + right.s;
+        return result;
+    }
 
-        fft(fa, false);
-        fft(fb, false);
-        for (size_t i = 0; i < n; i++)
-            fa[i] *= fb[i];
-        fft(fa, true);
+    // Terms of sum r^k / k! with r < 2^-magnitude that bring the error
+    // below 2^-bits.
+    static size_t series_terms(size_t magnitude, size_t bits) {
+        double log2_term = 0;
+        size_t k = 0;
+        while (log2_term > -(double)bits - 2) {
+            ++k;
+            log2_term -= magnitude + std::log2((double)k);
+        }
+        return k + 1;
+    }
+
+    // The bit-burst chunks of r = x / 2^bits, 0 <= r < 1: chunk i holds the
+    // bits of r between 2^-start and 2^-end as u / 2^end, with the chunk
+    // length doubling each time, so every chunk's series converges quickly
+    // while its numerator stays short.
+    struct Chunk {
+        limb_vector u;
+        size_t start, end;
+    };
+
+    static vector<Chunk> bit_burst(const limb_vector& x, size_t bits) {
+        vector<Chunk> chunks;
+        for (size_t start = 0, end = min(BIT_BURST_FIRST, bits); start < bits; start = end, end = min(2 * end, bits)) {
+            limb_vector u = low_bits(shift_right(x, bits - end), end - start);
+            if (!limbs_zero(u)) chunks.push_back({u, start, end});
+        }
+        return chunks;
+    }
+
+    // e^(u / 2^end) in fixed point.
+    static limb_vector exp_chunk(const Chunk& chunk, size_t bits) {
+        Series sum = split(0, series_terms(chunk.start, bits), [&](size_t k) {
+            if (k == 0) return Series{{limb_vector(1, 1), false}, limb_vector(1, 1), 0, {limb_vector(1, 1), false}};
+            return Series{{chunk.u, false}, limbs_of(k), chunk.end, {chunk.u, false}};
+        }, false);
+        return fixed_ratio(sum.t.mag, sum.q, sum.s, bits);
+    }
 
-        vector<int> res(n);
-        for (size_t i = 0; i < n; i++)
-            res[i] = round(fa[i].real());
+    // e^x for x >= 0, with a relative error of about 2^-bits. Halves x into
+    // [0, 1), sums the series by bit-burst and squares back up.
+    static limb_vector exp_fixed(const limb_vector& x, size_t bits) {
+        size_t length = bit_length(x);
+        size_t halvings = length > bits ? length - bits : 0;
+        size_t work = bits + 2 * halvings + 8;
+        limb_vector r = shift_left(x, work - bits - halvings);
+
+        limb_vector result = fixed_one(work);
+        for (const Chunk& chunk : bit_burst(r, work))
+            result = shift_right(mul_limbs(result, exp_chunk(chunk, work)), work);
+        for (size_t i = 0; i < halvings; ++i)
+            result = shift_right(mul_limbs(result, result), work);
+        return shift_right(result, work - bits);
+    }
 
+    // cos and sin of u / 2^end, from the series for sin(r) / r and cos(r).
+    static pair<limb_vector, limb_vector> cos_sin_chunk(const Chunk& chunk, size_t bits) {
+        size_t terms = series_terms(chunk.start, bits) / 2 + 2;
+        SignedLimbs u2 = {mul_limbs(chunk.u, chunk.u), true};
+        auto sum = [&](uint64_t offset) {
+            return split(0, terms, [&](size_t k) {
+                if (k == 0) return Series{{limb_vector(1, 1), false}, limb_vector(1, 1), 0, {limb_vector(1, 1), false}};
+                return Series{u2, limbs_of((2 * k - offset) * (2 * k + 1 - offset)), 2 * chunk.end, u2};
+            }, false);
+        };
+        Series cos_sum = sum(1), sin_sum = sum(0);
+        limb_vector c = fixed_ratio(cos_sum.t.mag, cos_sum.q, cos_sum.s, bits);
+        limb_vector s = fixed_ratio(mul_limbs(sin_sum.t.mag, chunk.u), sin_sum.q, sin_sum.s + chunk.end, bits);
+        return {c, s};
+    }
 
-        int carry = 0;
-        for (size_t i = 0; i < n; i++) {
-            res[i] += carry;
-            carry = res[i] / 10;
-            res[i] %= 10;
+    // cos r and sin r for |r| < 1, by bit-burst and the addition formulas.
+    static pair<SignedLimbs, SignedLimbs> cos_sin_fixed(const SignedLimbs& r, size_t bits) {
+        limb_vector c = fixed_one(bits), s(1, 0);
+        for (const Chunk& chunk : bit_burst(r.mag, bits)) {
+            auto [cc, sc] = cos_sin_chunk(chunk, bits);
+            limb_vector next_c = sub_limbs(mul_limbs(c, cc), mul_limbs(s, sc));
+            limb_vector next_s = add_limbs(mul_limbs(s, cc), mul_limbs(c, sc));
+            c = shift_right(next_c, bits);
+            s = shift_right(next_s, bits);
         }
-        while (carry) {
-            res.push_back(carry % 10);
-            carry /= 10;
+        return {{c, false}, {s, r.neg}};
+    }
+
+    // Chudnovsky series, summed by binary splitting: about 47 bits per term.
+    // The largest value computed so far is kept for later calls.
+    static limb_vector pi_fixed(size_t bits) {
+        static limb_vector cached;
+        static size_t cached_bits = 0;
+        if (cached_bits >= bits) return shift_right(cached, cached_bits - bits);
+
+        size_t work = bits + 16;
+        Series sum = split(0, work / 47 + 2, [](size_t k) {
+            if (k == 0) return Series{{limb_vector(1, 1), false}, limb_vector(1, 1), 0, {limbs_of(13591409), false}};
+            SignedLimbs p = {mul_limbs(mul_limbs(limbs_of(6 * k - 5), limbs_of(2 * k - 1)), limbs_of(6 * k - 1)), true};
+            limb_vector q = mul_limbs(mul_limbs(limbs_of(k), limbs_of(k * k)), limbs_of(10939058860032000ull));
+            return Series{p, q, 0, signed_mul(p, {limbs_of(13591409 + 545140134ull * k), false})};
+        }, false);
+
+        limb_vector root = isqrt_limbs(shift_left(limbs_of(10005), 2 * work));
+        limb_vector remainder;
+        limb_vector pi = divmod_limbs(mul_limbs(mul_limbs(root, limbs_of(426880)), sum.q), sum.t.mag, remainder);
+        cached = pi;
+        cached_bits = work;
+        return shift_right(pi, work - bits);
+    }
+
+    // cos and sin of *this, reduced by the nearest multiple k of pi/2.
+    pair<SignedLimbs, SignedLimbs> cos_sin(size_t bits) const {
+        // k * pi/2 loses as many bits as k has.
+        size_t work = bits + bit_length(trunc().mantissa) + 2;
+        limb_vector x = to_fixed(work).mag;
+        limb_vector half_pi = shift_right(pi_fixed(work + 1), 2);
+        limb_vector remainder;
+        limb_vector k = divmod_limbs(add_limbs(x, shift_right(half_pi, 1)), half_pi, remainder);
+        SignedLimbs r = signed_sub({x, false}, {mul_limbs(k, half_pi), false});
+        r.mag = shift_right(r.mag, work - bits);
+
+        auto [c, s] = cos_sin_fixed(r, bits);
+        switch (k[0] & 3) {
+            case 1: swap(c, s); c.neg = !c.neg; break;
+            case 2: c.neg = !c.neg; s.neg = !s.neg; break;
+            case 3: swap(c, s); s.neg = !s.neg; break;
         }
+        if (is_negative) s.neg = !s.neg;
+        return {c, s};
+    }
 
+public:
+    static constexpr int DEFAULT_PRECISION = 20;
 
-        while (res.size() > 1 && res.back() == 0)
-            res.pop_back();
+    // Fractional digits kept by every operation (the precision context).
+    // Integers are always exact.
+    static int precision() {
+        return current_precision;
+    }
 
+    static void set_precision(int digits) {
+        current_precision = max(0, digits);
+    }
 
-        int decimal_digits = decimal.size() + rhs.decimal.size();
-        BigNum result;
-        result.is_negative = is_negative ^ rhs.is_negative;
+    BigNum() : is_negative(false), mantissa(1, 0), scale(0) {}
 
+    BigNum trunc() const {
+        if (scale == 0) return *this;
+        return make(div_pow10(mantissa, scale), 0, is_negative);
+    }
 
-        result.decimal.resize(min(decimal_digits, DECIMAL_LIMIT));
-        for (int i = 0; i < result.decimal.size(); ++i) {
-            if (i < res.size()) {
-                result.decimal[i] = res[i];
-            } else {
-                result.decimal[i] = 0;
+    bool is_integer() const {
+        return scale == 0;
+    }
+
+    explicit BigNum(const string& s) {
+        string num = s;
+        is_negative = false;
+
+
+        if (!num.empty() && num[0] == '-') {
+            is_negative = true;
+            num = num.substr(1);
+        }
+
+
+        size_t e_pos = num.find_first_of("eE");
+        string exp_str;
+        long long exponent = 0;
+        if (e_pos != string::npos) {
+            exp_str = num.substr(e_pos + 1);
+            num = num.substr(0, e_pos);
+            try {
+                exponent = atoll(exp_str.c_str());
+            } catch (...) {
+                throw invalid_argument("Invalid exponent: " + exp_str);
             }
         }
 
 
-        result.integer.clear();
-        for (size_t i = decimal_digits; i < res.size(); ++i) {
-            result.integer.push_back(res[i]);
+        size_t dot_pos = num.find('.');
+        string int_part = (dot_pos != string::npos) ? num.substr(0, dot_pos) : num;
+        string dec_part = (dot_pos != string::npos) ? num.substr(dot_pos + 1) : "";
+
+
+        string digits = int_part + dec_part;
+        long long fraction_digits = (long long)dec_part.size() - exponent;
+        if (fraction_digits < 0) {
+            digits.append(-fraction_digits, '0');
+            fraction_digits = 0;
         }
-        if (result.integer.empty()) {
-            result.integer.push_back(0);
+        while (fraction_digits > 0 && digits.size() > 1 && digits.back() == '0') {
+            digits.pop_back();
+            --fraction_digits;
         }
 
-        reverse(result.decimal.begin(), result.decimal.end());
 
-        result.normalize();
-        return result;
+        digits.erase(0, min(digits.find_first_not_of('0'), digits.size()));
+        if (digits.empty()) digits = "0";
+        mantissa = limbs_from_digits(digits);
+        scale = (int)fraction_digits;
+
+        // Literals are exact; the precision applies to the results of operations.
+        strip_zeros();
     }
 
-    BigNum divide(const BigNum& divisor, int decimal_limit) const {
-        if (divisor == 0) {
-            throw std::runtime_error("Division by zero");
+
+    long long get_ll() const {
+        constexpr long long LL_MAX = std::numeric_limits<long long>::max();
+        constexpr long long LL_MIN = std::numeric_limits<long long>::min();
+
+
+        const limb_vector integer = scale == 0 ? mantissa : div_pow10(mantissa, scale);
+        const bool is_neg = is_negative && !is_zero();
+        if (integer.size() > 2)
+            return is_neg ? LL_MIN : LL_MAX;
+
+        uint64_t magnitude = integer[0] | (integer.size() > 1 ? (uint64_t)integer[1] << 32 : 0);
+        if (!is_neg)
+            return magnitude > (uint64_t)LL_MAX ? LL_MAX : (long long)magnitude;
+        return magnitude >= (uint64_t)LL_MAX + 1 ? LL_MIN : -(long long)magnitude;
+    }
+
+    // Stores the value in result if it is an integer that fits in int64_t.
+    bool fits_int64(int64_t& result) const {
+        if (scale != 0 || mantissa.size() > 2)
+            return false;
+        uint64_t magnitude = mantissa[0] | (mantissa.size() > 1 ? (uint64_t)mantissa[1] << 32 : 0);
+        if (is_negative && magnitude != 0) {
+            if (magnitude > (uint64_t)INT64_MAX + 1)
+                return false;
+            result = (int64_t)(0 - magnitude);
+            return true;
         }
+        if (magnitude > (uint64_t)INT64_MAX)
+            return false;
+        result = (int64_t)magnitude;
+        return true;
+    }
 
-        BigNum dividend = this->abs();
-        BigNum divisor_abs = divisor.abs();
+    // Nearest double (correctly rounded through the decimal form).
+    double to_double() const {
+        return strtod(to_string().c_str(), nullptr);
+    }
 
-        BigNum quotient;
-        BigNum remainder;
+    template<typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+    BigNum(T value) : is_negative(false), scale(0) {
+        if constexpr (std::is_integral<T>::value) {
+            mantissa = limbs_of(magnitude_of(value));
+            is_negative = value < 0;
+        } else {
+
+            std::ostringstream oss;
+            oss << std::fixed << std::setprecision(340) << value;
+            std::string s = oss.str();
 
-        for (int i = dividend.integer.size() - 1; i >= 0; --i) {
-            remainder = remainder * BigNum(10) + BigNum(dividend.integer[i]);
 
-            int digit = 0;
-            while (remainder >= divisor_abs) {
-                remainder = remainder - divisor_abs;
-                ++digit;
+            size_t dot_pos = s.find('.');
+            if (dot_pos != std::string::npos) {
+                s.erase(s.find_last_not_of('0') + 1, std::string::npos);
+                if (s.back() == '.') s.pop_back();
             }
-            quotient.integer.insert(quotient.integer.begin(), digit);
+            *this = BigNum(s);
+            normalize();
         }
+    }
 
-        if (!dividend.decimal.empty()) {
-            for (int i = 0; i < dividend.decimal.size(); ++i) {
-                remainder = remainder * BigNum(10) + BigNum(dividend.decimal[i]);
-                int digit = 0;
-                while (remainder >= divisor_abs) {
-                    remainder = remainder - divisor_abs;
-                    ++digit;
-                }
-                quotient.decimal.push_back(digit);
-            }
+
+    bool operator<(const BigNum& rhs) const {
+        if (is_negative != rhs.is_negative)
+            return is_negative;
+
+        int cmp = compare_abs(rhs);
+        return is_negative ? (cmp == 1) : (cmp == -1);
+    }
+
+    bool operator==(const BigNum& rhs) const {
+        return is_negative == rhs.is_negative &&
+               scale == rhs.scale &&
+               mantissa == rhs.mantissa;
+    }
+
+    bool operator!=(const BigNum& rhs) const { return !(*this == rhs); }
+
+    // Consistent with operator==, which compares the normalized fields.
+    size_t hash() const {
+        uint64_t h = ((uint64_t)(uint32_t)scale << 1) | is_negative;
+        for (size_t i = 0; i < mantissa.size(); ++i)
+            h = (h ^ mantissa[i]) * 0x100000001b3ULL;
+        return (size_t)h;
+    }
+    bool operator>(const BigNum& rhs) const { return rhs < *this; }
+    bool operator<=(const BigNum& rhs) const { return !(rhs < *this); }
+    bool operator>=(const BigNum& rhs) const { return !(*this < rhs); }
+
+    // Comparisons against machine integers (bounds checks, loop counters)
+    // compare limbs directly instead of converting the integer first.
+    template<typename T>
+    int compare_int(T value) const {
+        bool negative = value < 0;
+        if (is_negative != negative)
+            return is_negative ? -1 : 1;
+        limb_vector rhs = limbs_of(magnitude_of(value));
+        int cmp = compare_limbs(mantissa, scale == 0 ? rhs : mul_pow10(rhs, scale));
+        return negative ? -cmp : cmp;
+    }
+
+    template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    bool operator<(T rhs) const { return compare_int(rhs) < 0; }
+    template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    bool operator<=(T rhs) const { return compare_int(rhs) <= 0; }
+    template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    bool operator>(T rhs) const { return compare_int(rhs) > 0; }
+    template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    bool operator>=(T rhs) const { return compare_int(rhs) >= 0; }
+    template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    bool operator==(T rhs) const { return compare_int(rhs) == 0; }
+    template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    bool operator!=(T rhs) const { return compare_int(rhs) != 0; }
+
+    BigNum operator+(const BigNum& rhs) const {
+        if (is_negative != rhs.is_negative) {
+            BigNum tmp = rhs;
+            tmp.is_negative = !tmp.is_negative;
+            return *this - tmp;
         }
 
-        for (int i = 0; i < decimal_limit; ++i) {
-            remainder = remainder * BigNum(10);
-            int digit = 0;
-            while (remainder >= divisor_abs) {
-                remainder = remainder - divisor_abs;
-                ++digit;
-            }
-            quotient.decimal.push_back(digit);
+        int to = max(scale, rhs.scale);
+        return make(add_limbs(aligned(to), rhs.aligned(to)), to, is_negative);
+    }
+
+    BigNum operator-(const BigNum& rhs) const {
+        if (is_negative != rhs.is_negative) {
+            BigNum tmp = rhs;
+            tmp.is_negative = !tmp.is_negative;
+            return *this + tmp;
         }
 
-        quotient.is_negative = is_negative ^ divisor.is_negative;
-        quotient.normalize();
-        return quotient;
+        int to = max(scale, rhs.scale);
+        limb_vector a = aligned(to), b = rhs.aligned(to);
+        if (compare_limbs(a, b) < 0)
+            return make(sub_limbs(b, a), to, !is_negative);
+        return make(sub_limbs(a, b), to, is_negative);
+    }
+
+    BigNum operator*(const BigNum& rhs) const {
+        if (is_zero() || rhs.is_zero()) return BigNum();
+        return make(mul_limbs(mantissa, rhs.mantissa), scale + rhs.scale, is_negative ^ rhs.is_negative);
+    }
+
+    // Quotient truncated to `digits` fractional digits (at most the precision).
+    BigNum divide(const BigNum& divisor, int digits) const {
+        if (divisor == 0) {
+            throw std::runtime_error("Division by zero");
+        }
+
+        digits = min(digits, current_precision);
+        limb_vector remainder;
+        limb_vector numerator = mul_pow10(mantissa, digits + divisor.scale - scale);
+        int extra = scale - digits - divisor.scale;
+        limb_vector denominator = extra > 0 ? mul_pow10(divisor.mantissa, extra) : divisor.mantissa;
+        return make(divmod_limbs(numerator, denominator, remainder), digits, is_negative ^ divisor.is_negative);
     }
 
     BigNum operator/(const BigNum& rhs) const {
-        return this->divide(rhs, DECIMAL_LIMIT);
+        return this->divide(rhs, current_precision);
+    }
+
+    // Truncating division: returns trunc(*this / rhs) and stores
+    // *this - quotient * rhs, which has the sign of *this, in remainder.
+    BigNum divmod(const BigNum& rhs, BigNum& remainder) const {
+        if (rhs.is_zero()) {
+            throwZeroDivisionError("Division by zero");
+        }
+
+        int to = max(scale, rhs.scale);
+        limb_vector rem;
+        BigNum quotient = make(divmod_limbs(aligned(to), rhs.aligned(to), rem), 0, is_negative ^ rhs.is_negative);
+        remainder = make(rem, to, is_negative);
+        return quotient;
     }
 
     BigNum operator%(const BigNum& rhs) const {
-        if (rhs == 0) {
+        if (rhs.is_zero()) {
             throwZeroDivisionError("Modulo by zero");
         }
-        BigNum q = *this / rhs;
-        BigNum q_trunc = q.trunc();
-        BigNum remainder = *this - q_trunc * rhs;
-        remainder.is_negative = this->is_negative;
-        remainder.normalize();
-        if (remainder.is_zero()) {
-            remainder.is_negative = false;
-        }
+        BigNum remainder;
+        divmod(rhs, remainder);
         return remainder;
     }
 
@@ -496,70 +1616,34 @@ public:
 
     string to_string() const {
         string s;
-        if (is_negative && !(integer.size() == 1 && integer[0] == 0 && decimal.empty()))
+        if (is_negative && !is_zero())
             s += '-';
 
-        for (auto it = integer.rbegin(); it != integer.rend(); ++it)
-            s += char('0' + *it);
+        string digits = digits_from_limbs(mantissa);
+        if (scale == 0)
+            return s + digits;
 
-        if (!decimal.empty()) {
-            s += '.';
-            for (int d : decimal)
-                s += char('0' + d);
-        }
+        if ((int)digits.size() <= scale)
+            digits.insert(0, scale + 1 - digits.size(), '0');
+        s += digits.substr(0, digits.size() - scale);
+        s += '.';
+        s += digits.substr(digits.size() - scale);
         return s;
     }
 
     BigNum sqrt() const {
-        const BigNum& S = *this;
-        if (S.is_negative) {
+        if (is_negative) {
             throw std::runtime_error("Square root of a negative number is undefined.");
         }
-        if (S.is_zero()) {
-            return BigNum(0);
-        }
+        return make(isqrt_limbs(mul_pow10(mantissa, 2 * current_precision - scale)), current_precision, false);
+    }
 
-        BigNum x0;
-        if (!S.integer.empty() && !(S.integer.size() == 1 && S.integer[0] == 0)) {
-            int m = S.integer.size();
-            int e = m - 1;
-            int initial_exponent = e / 2;
-            x0 = BigNum("1e" + std::to_string(initial_exponent));
-        } else {
-            int k = 0;
-            while (k < S.decimal.size() && S.decimal[k] == 0) {
-                ++k;
-            }
-            if (k == S.decimal.size()) {
-                return BigNum(0);
-            }
-            int e = -(k + 1);
-            int initial_exponent = e / 2;
-            x0 = BigNum("1e" + std::to_string(initial_exponent));
-        }
-
-        const int sqrt_decimal_limit = DECIMAL_LIMIT;
-        const BigNum threshold("1e-" + std::to_string(sqrt_decimal_limit));
-
-        BigNum x = x0;
-        BigNum prev;
-        const int max_iterations = 100;
-        for (int i = 0; i < max_iterations; ++i) {
-            prev = x;
-            BigNum s_div_x = S.divide(x, sqrt_decimal_limit);
-            x = (x + s_div_x).divide(BigNum(2), sqrt_decimal_limit);
-            x.decimal.resize(sqrt_decimal_limit);
-            x.normalize();
-
-            BigNum diff = (x - prev).abs();
-            if (diff.compare_abs(threshold) == -1) {
-                break;
-            }
+    // Exact floor(sqrt(trunc(*this))).
+    BigNum isqrt() const {
+        if (is_negative && !is_zero()) {
+            throwRuntimeError("isqrt() of a negative number");
         }
-
-        x.decimal.resize(DECIMAL_LIMIT);
-        x.normalize();
-        return x;
+        return make(isqrt_limbs(trunc().mantissa), 0, false);
     }
 
     BigNum pow(const BigNum& exponent) const {
@@ -573,16 +1657,13 @@ public:
             return BigNum(0);
         }
 
-        BigNum abs_exp = exponent.abs();
+        const limb_vector bits = exponent.trunc().mantissa;
         BigNum result(1);
-        BigNum base = *this;
-
-        while (abs_exp > BigNum(0)) {
-            if (abs_exp % BigNum(2) == BigNum(1)) {
-                result = result * base;
+        for (size_t bit = bit_length(bits); bit-- > 0;) {
+            result = result * result;
+            if (test_bit(bits, bit)) {
+                result = result * *this;
             }
-            base = base * base;
-            abs_exp = (abs_exp / BigNum(2)).trunc();
         }
 
         if (exponent.is_negative) {
@@ -591,28 +1672,239 @@ public:
         return result;
     }
 
-private:
-    int compare_abs(const BigNum& rhs) const {
+    // (*this ^ exponent) mod modulus for integers, exponent >= 0 and
+    // modulus > 0; the result is in [0, modulus).
+    BigNum powmod(const BigNum& exponent, const BigNum& modulus) const {
+        if (scale != 0 || exponent.scale != 0 || modulus.scale != 0) {
+            throwRuntimeError("powmod() requires integers");
+        }
+        if (exponent.is_negative) {
+            throwRuntimeError("powmod() exponent must not be negative");
+        }
+        if (modulus.is_zero()) {
+            throwZeroDivisionError("powmod() modulus is zero");
+        }
+        if (modulus.is_negative) {
+            throwRuntimeError("powmod() modulus must be positive");
+        }
 
-        if (integer.size() != rhs.integer.size())
-            return (integer.size() < rhs.integer.size()) ? -1 : 1;
+        const limb_vector& m = modulus.mantissa;
+        limb_vector base;
+        divmod_limbs(mantissa, m, base);
+        if (is_negative && !(base.size() == 1 && base[0] == 0)) {
+            base = sub_limbs(m, base);
+        }
 
+        BigNum result;
+        if (m.size() == 1 && m[0] == 1) {
+            return result;
+        }
+        if (m[0] & 1) {
+            Montgomery mont(m);
+            result.mantissa = mont.from_form(mont_pow(mont, base, exponent.mantissa));
+        } else {
+            Barrett barrett(m);
+            limb_vector acc(1, 1);
+            for (size_t bit = bit_length(exponent.mantissa); bit-- > 0;) {
+                acc = barrett.reduce(mul_limbs(acc, acc));
+                if (test_bit(exponent.mantissa, bit)) acc = barrett.reduce(mul_limbs(acc, base));
+            }
+            result.mantissa = acc;
+        }
+        result.normalize();
+        return result;
+    }
 
-        for (int i = integer.size()-1; i >= 0; --i) {
-            if (integer[i] != rhs.integer[i])
-                return (integer[i] < rhs.integer[i]) ? -1 : 1;
+    // gcd, lcm and modinv take integers; gcd and lcm are never negative.
+    BigNum gcd(const BigNum& rhs) const {
+        if (scale != 0 || rhs.scale != 0) {
+            throwRuntimeError("gcd() requires integers");
         }
+        if (compare_limbs(mantissa, rhs.mantissa) >= 0) return make(gcd_limbs(mantissa, rhs.mantissa), 0, false);
+        return make(gcd_limbs(rhs.mantissa, mantissa), 0, false);
+    }
 
+    BigNum lcm(const BigNum& rhs) const {
+        if (scale != 0 || rhs.scale != 0) {
+            throwRuntimeError("lcm() requires integers");
+        }
+        if (is_zero() || rhs.is_zero()) return BigNum();
+        BigNum remainder;
+        return (abs().divmod(gcd(rhs), remainder) * rhs).abs();
+    }
 
-        size_t max_dec = max(decimal.size(), rhs.decimal.size());
-        for (size_t i = 0; i < max_dec; ++i) {
-            int a = (i < decimal.size()) ? decimal[i] : 0;
-            int b = (i < rhs.decimal.size()) ? rhs.decimal[i] : 0;
-            if (a != b)
-                return (a < b) ? -1 : 1;
+    // x in [0, modulus) with *this * x = 1 (mod modulus).
+    BigNum modinv(const BigNum& modulus) const {
+        if (scale != 0 || modulus.scale != 0) {
+            throwRuntimeError("modinv() requires integers");
+        }
+        if (modulus.is_negative || modulus.is_zero()) {
+            throwRuntimeError("modinv() modulus must be positive");
+        }
+        const limb_vector& m = modulus.mantissa;
+        limb_vector a;
+        divmod_limbs(mantissa, m, a);
+        if (is_negative && !limbs_zero(a)) a = sub_limbs(m, a);
+
+        SignedLimbs t0 = {limb_vector(1, 0), false}, t1 = {limb_vector(1, 1), false};
+        limb_vector g = gcd_limbs(m, a, &t0, &t1);
+        if (!(g.size() == 1 && g[0] == 1)) {
+            throwRuntimeError("modinv() argument is not invertible");
+        }
+        limb_vector x;
+        divmod_limbs(t0.mag, m, x);
+        if (t0.neg && !limbs_zero(x)) x = sub_limbs(m, x);
+        return make(x, 0, false);
+    }
+
+    // Miller-Rabin after trial division by the primes below 256.
+    bool is_prime() const {
+        if (scale != 0 || is_negative) return false;
+        static const vector<uint32_t> small_primes = [] {
+            vector<uint32_t> primes;
+            for (uint32_t p = 2; p < 256; ++p) {
+                bool prime = true;
+                for (uint32_t q : primes) prime = prime && p % q != 0;
+                if (prime) primes.push_back(p);
+            }
+            return primes;
+        }();
+
+        for (uint32_t p : small_primes) {
+            if (mantissa.size() == 1 && mantissa[0] == p) return true;
+            limb_vector rest = mantissa;
+            if (divmod_small(rest, p) == 0) return false;
+        }
+        if (mantissa.size() == 1 && mantissa[0] < 256 * 256) return mantissa[0] > 1;
+
+        static const uint32_t bases[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41};
+        if (mantissa.size() <= 2) {
+            uint64_t n = mantissa[0] | (mantissa.size() > 1 ? (uint64_t)mantissa[1] << 32 : 0);
+            for (uint32_t base : bases)
+                if (!miller_rabin64(n, base)) return false;
+            return true;
         }
 
-        return 0;
+        Montgomery mont(mantissa);
+        for (uint32_t base : bases)
+            if (!miller_rabin(mont, mantissa, limb_vector(1, base))) return false;
+        if (bit_length(mantissa) <= 81) return true;
+
+        mt19937_64 generator(0x9E3779B97F4A7C15ull);
+        limb_vector range = sub_limbs(mantissa, limb_vector(1, 3));
+        for (int round = 0; round < MILLER_RABIN_ROUNDS; ++round) {
+            limb_vector draw(mantissa.size(), 0);
+            for (uint32_t& limb : draw) limb = (uint32_t)generator();
+            trim(draw);
+            limb_vector base;
+            divmod_limbs(draw, range, base);
+            if (!miller_rabin(mont, mantissa, add_limbs(base, limb_vector(1, 2)))) return false;
+        }
+        return true;
+    }
+
+    // The elementary functions below keep the current precision.
+    BigNum exp() const {
+        if (is_zero()) return BigNum(1);
+        int digits = current_precision;
+        double approx = to_double();
+        if (approx > EXP_MAX_ARGUMENT) {
+            throwRuntimeError("exp() argument too large");
+        }
+        // Below 10^-(digits + 1) the truncated result is zero.
+        if (approx < -(digits + 1) * M_LN10 - 1) return BigNum();
+
+        size_t bits = bits_for_digits(digits);
+        if (is_negative) {
+            limb_vector y = exp_fixed(to_fixed(bits).mag, bits);
+            return from_fixed(fixed_div({fixed_one(bits), false}, {y, false}, bits), bits, digits);
+        }
+        // Every integer digit of the result has to be exact as well.
+        bits += (size_t)(approx * M_LOG2E) + 2;
+        return from_fixed({exp_fixed(to_fixed(bits).mag, bits), false}, bits, digits);
+    }
+
+    // Halley's iteration y += 2 (x - e^y) / (x + e^y).
+    BigNum ln() const {
+        if (is_negative || is_zero()) {
+            throwRuntimeError("ln() of a non-positive number");
+        }
+        if (*this == 1) return BigNum();
+        int digits = current_precision;
+        double approx = approx_log();
+        // e^y needs as many more bits as it has leading or trailing zero bits.
+        size_t extra = (size_t)(std::fabs(approx) * M_LOG2E) + 2;
+        size_t bits = bits_for_digits(digits) + extra;
+
+        vector<size_t> steps = precision_steps(bits_for_digits(digits));
+        SignedLimbs y = fixed_of(approx, steps[0] + extra);
+        size_t y_bits = steps[0] + extra;
+        for (size_t step : steps) {
+            step += extra;
+            y.mag = shift_left(y.mag, step - y_bits);
+            y_bits = step;
+            limb_vector e = exp_fixed(y.mag, step);
+            if (y.neg) e = fixed_div({fixed_one(step), false}, {e, false}, step).mag;
+            SignedLimbs x = to_fixed(step);
+            SignedLimbs difference = signed_sub(x, {e, false});
+            difference.mag = shift_left(difference.mag, 1);
+            y = signed_add(y, fixed_div(difference, {add_limbs(x.mag, e), false}, step));
+        }
+        return from_fixed(y, bits, digits);
+    }
+
+    BigNum sin() const {
+        size_t bits = bits_for_digits(current_precision);
+        return from_fixed(cos_sin(bits).second, bits, current_precision);
+    }
+
+    BigNum cos() const {
+        size_t bits = bits_for_digits(current_precision);
+        return from_fixed(cos_sin(bits).first, bits, current_precision);
+    }
+
+    // Newton-like step theta += tan(atan x - theta), cubically convergent, on
+    // |x| <= 1; larger arguments use atan x = pi/2 - atan(1/x).
+    BigNum atan() const {
+        if (is_zero()) return BigNum();
+        int digits = current_precision;
+        size_t bits = bits_for_digits(digits);
+        SignedLimbs x = to_fixed(bits);
+        x.neg = false;
+        bool inverted = compare_limbs(x.mag, fixed_one(bits)) > 0;
+        if (inverted) x = fixed_div({fixed_one(bits), false}, x, bits);
+        double approx = std::fabs(to_double());
+
+        vector<size_t> steps = precision_steps(bits);
+        SignedLimbs theta = fixed_of(std::atan(inverted ? 1 / approx : approx), steps[0]);
+        size_t theta_bits = steps[0];
+        for (size_t step : steps) {
+            theta.mag = shift_left(theta.mag, step - theta_bits);
+            theta_bits = step;
+            SignedLimbs t = {shift_right(x.mag, bits - step), false};
+            auto [c, s] = cos_sin_fixed(theta, step);
+            SignedLimbs num = signed_sub(fixed_mul(t, c, step), s);
+            SignedLimbs den = signed_add(c, fixed_mul(t, s, step));
+            theta = signed_add(theta, fixed_div(num, den, step));
+        }
+        if (inverted) theta = signed_sub({shift_right(pi_fixed(bits), 1), false}, theta);
+        theta.neg = is_negative;
+        return from_fixed(theta, bits, digits);
+    }
+
+    // pi truncated to `digits` fractional digits, which may exceed the
+    // precision.
+    static BigNum pi(int digits) {
+        size_t bits = bits_for_digits(digits);
+        return from_fixed({pi_fixed(bits), false}, bits, digits);
+    }
+
+private:
+    int compare_abs(const BigNum& rhs) const {
+        if (scale == rhs.scale)
+            return compare_limbs(mantissa, rhs.mantissa);
+        int to = max(scale, rhs.scale);
+        return compare_limbs(aligned(to), rhs.aligned(to));
     }
 };
 
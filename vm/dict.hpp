@@ -0,0 +1,191 @@
+#ifndef DICT_HPP
+#define DICT_HPP
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <functional>
+#include "../parser/value.hpp"
+#include "../parser/errors.hpp"
+
+// Insertion-ordered hash table behind Value::DICT. Entries are kept in one
+// dense array; the open-addressing table holds 8-byte slots (an entry index
+// plus the upper half of its hash), so linear probing over the power-of-two
+// table stays within a cache line or two and only touches an entry whose
+// hash already matches. Iteration never visits empty slots. Erasing leaves a
+// tombstone in both arrays until the next rebuild.
+//
+// Value::SET uses the same table through contains/add/erase and keeps
+// no values.
+class Dict {
+public:
+    struct Entry {
+        size_t hash;
+        Value key;      // NULL_TYPE once erased
+    };
+
+    // Keys are numbers or strings. Numbers hash their normalized fields,
+    // so equal BigNums always land on the same hash.
+    static size_t hashKey(const Value& key) {
+        uint64_t h;
+        if (key.type == Value::NUMBER) {
+            h = key.bignumValue.hash();
+        } else if (key.type == Value::STRING) {
+            h = std::hash<std::string>{}(key.strValue) ^ 0x5bd1e995u;
+        } else {
+            throwTypeError("Dict keys must be numbers or strings");
+            return 0;
+        }
+        // splitmix64 finalizer: linear probing needs the low bits well mixed.
+        h ^= h >> 30; h *= 0xbf58476d1ce4e5b9ULL;
+        h ^= h >> 27; h *= 0x94d049bb133111ebULL;
+        h ^= h >> 31;
+        return (size_t)h;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    bool contains(const Value& key) const {
+        return slotOf(key, hashKey(key)) != SIZE_MAX;
+    }
+
+    const Value* find(const Value& key) const {
+        size_t slot = slotOf(key, hashKey(key));
+        return slot == SIZE_MAX ? nullptr : &values[slots[slot].index];
+    }
+
+    void insert(const Value& key, Value value) {
+        size_t hash = hashKey(key);
+        size_t slot = slotOf(key, hash);
+        if (slot != SIZE_MAX) {
+            values[slots[slot].index] = std::move(value);
+            return;
+        }
+        append(key, hash);
+        values.push_back(std::move(value));
+    }
+
+    // Set insertion; returns false if the key was already present.
+    bool add(const Value& key) {
+        size_t hash = hashKey(key);
+        if (slotOf(key, hash) != SIZE_MAX) return false;
+        append(key, hash);
+        return true;
+    }
+
+    bool erase(const Value& key) {
+        size_t slot = slotOf(key, hashKey(key));
+        if (slot == SIZE_MAX) return false;
+        int32_t index = slots[slot].index;
+        entries[index] = Entry{0, Value()};
+        if (!values.empty()) values[index] = Value();
+        slots[slot] = {0, DELETED};
+        count--;
+        return true;
+    }
+
+    // Calls f(key) for every live entry, in insertion order.
+    template<typename F>
+    void forEachKey(F&& f) const {
+        for (const Entry& entry : entries) {
+            if (entry.key.type != Value::NULL_TYPE) f(entry.key);
+        }
+    }
+
+    // Calls f(key, value) for every live entry of a dict, in insertion order.
+    template<typename F>
+    void forEach(F&& f) const {
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (entries[i].key.type != Value::NULL_TYPE) f(entries[i].key, values[i]);
+        }
+    }
+
+private:
+    static constexpr int32_t EMPTY = -1;
+    static constexpr int32_t DELETED = -2;
+    static constexpr size_t MIN_SLOTS = 8;
+
+    struct Slot {
+        uint32_t tag;
+        int32_t index;
+    };
+
+    std::vector<Slot> slots;
+    std::vector<Entry> entries;
+    std::vector<Value> values;      // parallel to entries; empty for sets
+    size_t count = 0;
+
+    // The probe position comes from the low bits, so the tag uses the high ones.
+    static uint32_t tagOf(size_t hash) {
+        return (uint32_t)((uint64_t)hash >> 32);
+    }
+
+    static bool matches(const Entry& entry, const Value& key) {
+        if (entry.key.type != key.type) return false;
+        if (key.type == Value::NUMBER) return entry.key.bignumValue == key.bignumValue;
+        return entry.key.strValue == key.strValue;
+    }
+
+    // Slot holding key, or SIZE_MAX.
+    size_t slotOf(const Value& key, size_t hash) const {
+        if (count == 0) return SIZE_MAX;
+        size_t mask = slots.size() - 1;
+        for (size_t i = hash & mask;; i = (i + 1) & mask) {
+            const Slot& slot = slots[i];
+            if (slot.index == EMPTY) return SIZE_MAX;
+            if (slot.tag == tagOf(hash) && slot.index != DELETED && matches(entries[slot.index], key)) return i;
+        }
+    }
+
+    // Adds an entry for a key known to be absent.
+    void append(const Value& key, size_t hash) {
+        if ((entries.size() + 1) * 3 > slots.size() * 2) rebuild(count + 1);
+        size_t mask = slots.size() - 1;
+        size_t i = hash & mask;
+        while (slots[i].index >= 0) i = (i + 1) & mask;
+        slots[i] = {tagOf(hash), (int32_t)entries.size()};
+        entries.push_back({hash, key});
+        count++;
+    }
+
+    // Drops tombstones and re-indexes into a table at most half full.
+    void rebuild(size_t needed) {
+        size_t size = MIN_SLOTS;
+        while (size < needed * 2) size <<= 1;
+        if (size > (size_t)INT32_MAX) throwRuntimeError("Dict too large");
+
+        if (count != entries.size()) {
+            size_t live = 0;
+            for (size_t i = 0; i < entries.size(); i++) {
+                if (entries[i].key.type == Value::NULL_TYPE) continue;
+                if (live != i) {
+                    entries[live] = std::move(entries[i]);
+                    if (!values.empty()) values[live] = std::move(values[i]);
+                }
+                live++;
+            }
+            entries.resize(live);
+            if (!values.empty()) values.resize(live);
+        }
+
+        slots.assign(size, Slot{0, EMPTY});
+        size_t mask = size - 1;
+        for (size_t e = 0; e < entries.size(); e++) {
+            size_t i = entries[e].hash & mask;
+            while (slots[i].index != EMPTY) i = (i + 1) & mask;
+            slots[i] = {tagOf(entries[e].hash), (int32_t)e};
+        }
+    }
+};
+
+// Dicts and sets are shared between copies of a Value; this detaches the
+// table before the first write so the other copies keep the old contents.
+inline Dict& mutableDict(Value& value) {
+    if (value.dictValue.use_count() > 1) value.dictValue = std::make_shared<Dict>(*value.dictValue);
+    return *value.dictValue;
+}
+
+#endif
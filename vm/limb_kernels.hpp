@@ -0,0 +1,226 @@
+#ifndef LIMB_KERNELS_HPP
+#define LIMB_KERNELS_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define LIMB_KERNELS_X86 1
+#endif
+
+// Carry-propagating add, subtract and compare over little-endian base 2^32
+// limb arrays, used by BigNum. The x86 versions handle 4 (SSE2) or 8 (AVX2)
+// limbs per step. Lanes are added independently, then the carry chain of the
+// whole block is resolved with one scalar addition on the lane masks: with
+// g = lanes that overflowed and p = lanes that would pass a carry on (all
+// ones for addition, zero for subtraction), the lanes receiving a carry are
+// ((g << 1) + p + carry_in) ^ p. The best variant is picked once at runtime.
+namespace limb_kernels {
+
+// Below this many limbs the dispatch costs more than it saves.
+const size_t SIMD_MIN_LIMBS = 16;
+
+inline uint32_t add_n_scalar(uint32_t* r, const uint32_t* a, const uint32_t* b, size_t n, uint32_t carry) {
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t sum = (uint64_t)a[i] + b[i] + carry;
+        r[i] = (uint32_t)sum;
+        carry = (uint32_t)(sum >> 32);
+    }
+    return carry;
+}
+
+inline uint32_t sub_n_scalar(uint32_t* r, const uint32_t* a, const uint32_t* b, size_t n, uint32_t borrow) {
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t diff = (uint64_t)a[i] - b[i] - borrow;
+        r[i] = (uint32_t)diff;
+        borrow = (uint32_t)(diff >> 63);
+    }
+    return borrow;
+}
+
+inline int cmp_n_scalar(const uint32_t* a, const uint32_t* b, size_t n) {
+    for (size_t i = n; i-- > 0;) {
+        if (a[i] != b[i])
+            return a[i] < b[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+#ifdef LIMB_KERNELS_X86
+
+__attribute__((target("sse2")))
+inline uint32_t add_n_sse2(uint32_t* r, const uint32_t* a, const uint32_t* b, size_t n, uint32_t carry) {
+    const __m128i sign = _mm_set1_epi32((int)0x80000000);
+    const __m128i ones = _mm_set1_epi32(-1);
+    const __m128i lane_bits = _mm_setr_epi32(1, 2, 4, 8);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i s = _mm_add_epi32(x, _mm_loadu_si128((const __m128i*)(b + i)));
+        __m128i overflow = _mm_cmpgt_epi32(_mm_xor_si128(x, sign), _mm_xor_si128(s, sign));
+        uint32_t g = _mm_movemask_ps(_mm_castsi128_ps(overflow));
+        uint32_t p = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(s, ones)));
+        uint32_t z = (g << 1) + p + carry;
+        __m128i c = _mm_and_si128(_mm_set1_epi32((int)(z ^ p)), lane_bits);
+        s = _mm_sub_epi32(s, _mm_cmpeq_epi32(c, lane_bits));
+        _mm_storeu_si128((__m128i*)(r + i), s);
+        carry = (z >> 4) & 1;
+    }
+    return add_n_scalar(r + i, a + i, b + i, n - i, carry);
+}
+
+__attribute__((target("sse2")))
+inline uint32_t sub_n_sse2(uint32_t* r, const uint32_t* a, const uint32_t* b, size_t n, uint32_t borrow) {
+    const __m128i sign = _mm_set1_epi32((int)0x80000000);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lane_bits = _mm_setr_epi32(1, 2, 4, 8);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i y = _mm_loadu_si128((const __m128i*)(b + i));
+        __m128i d = _mm_sub_epi32(x, y);
+        __m128i underflow = _mm_cmplt_epi32(_mm_xor_si128(x, sign), _mm_xor_si128(y, sign));
+        uint32_t g = _mm_movemask_ps(_mm_castsi128_ps(underflow));
+        uint32_t p = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(d, zero)));
+        uint32_t z = (g << 1) + p + borrow;
+        __m128i c = _mm_and_si128(_mm_set1_epi32((int)(z ^ p)), lane_bits);
+        d = _mm_add_epi32(d, _mm_cmpeq_epi32(c, lane_bits));
+        _mm_storeu_si128((__m128i*)(r + i), d);
+        borrow = (z >> 4) & 1;
+    }
+    return sub_n_scalar(r + i, a + i, b + i, n - i, borrow);
+}
+
+__attribute__((target("sse2")))
+inline int cmp_n_sse2(const uint32_t* a, const uint32_t* b, size_t n) {
+    size_t i = n;
+    for (; i >= 4; i -= 4) {
+        __m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(a + i - 4)),
+                                     _mm_loadu_si128((const __m128i*)(b + i - 4)));
+        if (_mm_movemask_epi8(eq) != 0xFFFF)
+            return cmp_n_scalar(a + i - 4, b + i - 4, 4);
+    }
+    return cmp_n_scalar(a, b, i);
+}
+
+__attribute__((target("avx2")))
+inline uint32_t add_n_avx2(uint32_t* r, const uint32_t* a, const uint32_t* b, size_t n, uint32_t carry) {
+    const __m256i ones = _mm256_set1_epi32(-1);
+    const __m256i lane_bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i s = _mm256_add_epi32(x, _mm256_loadu_si256((const __m256i*)(b + i)));
+        __m256i no_overflow = _mm256_cmpeq_epi32(_mm256_max_epu32(s, x), s);
+        uint32_t g = ~_mm256_movemask_ps(_mm256_castsi256_ps(no_overflow)) & 0xFF;
+        uint32_t p = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(s, ones)));
+        uint32_t z = (g << 1) + p + carry;
+        __m256i c = _mm256_and_si256(_mm256_set1_epi32((int)(z ^ p)), lane_bits);
+        s = _mm256_sub_epi32(s, _mm256_cmpeq_epi32(c, lane_bits));
+        _mm256_storeu_si256((__m256i*)(r + i), s);
+        carry = (z >> 8) & 1;
+    }
+    return add_n_scalar(r + i, a + i, b + i, n - i, carry);
+}
+
+__attribute__((target("avx2")))
+inline uint32_t sub_n_avx2(uint32_t* r, const uint32_t* a, const uint32_t* b, size_t n, uint32_t borrow) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i lane_bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i y = _mm256_loadu_si256((const __m256i*)(b + i));
+        __m256i d = _mm256_sub_epi32(x, y);
+        __m256i no_underflow = _mm256_cmpeq_epi32(_mm256_max_epu32(x, y), x);
+        uint32_t g = ~_mm256_movemask_ps(_mm256_castsi256_ps(no_underflow)) & 0xFF;
+        uint32_t p = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(d, zero)));
+        uint32_t z = (g << 1) + p + borrow;
+        __m256i c = _mm256_and_si256(_mm256_set1_epi32((int)(z ^ p)), lane_bits);
+        d = _mm256_add_epi32(d, _mm256_cmpeq_epi32(c, lane_bits));
+        _mm256_storeu_si256((__m256i*)(r + i), d);
+        borrow = (z >> 8) & 1;
+    }
+    return sub_n_scalar(r + i, a + i, b + i, n - i, borrow);
+}
+
+__attribute__((target("avx2")))
+inline int cmp_n_avx2(const uint32_t* a, const uint32_t* b, size_t n) {
+    size_t i = n;
+    for (; i >= 8; i -= 8) {
+        __m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(a + i - 8)),
+                                        _mm256_loadu_si256((const __m256i*)(b + i - 8)));
+        if ((uint32_t)_mm256_movemask_epi8(eq) != 0xFFFFFFFFu)
+            return cmp_n_scalar(a + i - 8, b + i - 8, 8);
+    }
+    return cmp_n_scalar(a, b, i);
+}
+
+#endif
+
+struct kernel_table {
+    uint32_t (*add_n)(uint32_t*, const uint32_t*, const uint32_t*, size_t, uint32_t);
+    uint32_t (*sub_n)(uint32_t*, const uint32_t*, const uint32_t*, size_t, uint32_t);
+    int (*cmp_n)(const uint32_t*, const uint32_t*, size_t);
+};
+
+inline const kernel_table& kernels() {
+    static const kernel_table table = [] {
+#ifdef LIMB_KERNELS_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return kernel_table{add_n_avx2, sub_n_avx2, cmp_n_avx2};
+        if (__builtin_cpu_supports("sse2"))
+            return kernel_table{add_n_sse2, sub_n_sse2, cmp_n_sse2};
+#endif
+        return kernel_table{add_n_scalar, sub_n_scalar, cmp_n_scalar};
+    }();
+    return table;
+}
+
+// r[0..n) = a + b + carry; returns the carry out. r may alias a or b.
+inline uint32_t add_n(uint32_t* r, const uint32_t* a, const uint32_t* b, size_t n, uint32_t carry = 0) {
+    if (n < SIMD_MIN_LIMBS) return add_n_scalar(r, a, b, n, carry);
+    return kernels().add_n(r, a, b, n, carry);
+}
+
+// r[0..n) = a - b - borrow; returns the borrow out. r may alias a or b.
+inline uint32_t sub_n(uint32_t* r, const uint32_t* a, const uint32_t* b, size_t n, uint32_t borrow = 0) {
+    if (n < SIMD_MIN_LIMBS) return sub_n_scalar(r, a, b, n, borrow);
+    return kernels().sub_n(r, a, b, n, borrow);
+}
+
+// Three-way comparison of two n-limb magnitudes.
+inline int cmp_n(const uint32_t* a, const uint32_t* b, size_t n) {
+    if (n < SIMD_MIN_LIMBS) return cmp_n_scalar(a, b, n);
+    return kernels().cmp_n(a, b, n);
+}
+
+// r[0..n) = a + carry; copies once the carry dies out. Returns the carry out.
+inline uint32_t add_1(uint32_t* r, const uint32_t* a, size_t n, uint32_t carry) {
+    size_t i = 0;
+    for (; i < n && carry; ++i) {
+        r[i] = a[i] + 1;
+        carry = r[i] == 0;
+    }
+    if (r != a && i < n) memcpy(r + i, a + i, (n - i) * sizeof(uint32_t));
+    return carry;
+}
+
+// r[0..n) = a - borrow; copies once the borrow dies out. Returns the borrow out.
+inline uint32_t sub_1(uint32_t* r, const uint32_t* a, size_t n, uint32_t borrow) {
+    size_t i = 0;
+    for (; i < n && borrow; ++i) {
+        uint32_t limb = a[i];
+        r[i] = limb - 1;
+        borrow = limb == 0;
+    }
+    if (r != a && i < n) memcpy(r + i, a + i, (n - i) * sizeof(uint32_t));
+    return borrow;
+}
+
+}
+
+#endif
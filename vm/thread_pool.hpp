@@ -0,0 +1,152 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <algorithm>
+
+// Fixed set of worker threads for data-parallel loops inside the runtime
+// (currently the BigNum NTT). Workers are started on first use. The calling
+// thread takes part in every loop, so a pool of N threads has N - 1 workers.
+// Loops started from inside a worker run serially on that worker.
+class ThreadPool {
+public:
+    static ThreadPool& instance() {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    size_t threadCount() const {
+        return threads;
+    }
+
+    // 0 selects the hardware concurrency.
+    void setThreadCount(size_t count) {
+        if (count == 0) count = defaultThreadCount();
+        std::lock_guard<std::mutex> guard(loopMutex);
+        stopWorkers();
+        threads = count;
+    }
+
+    // Calls body(i) for every i in [0, count), spread over the pool.
+    template<typename F>
+    void parallelFor(size_t count, F&& body) {
+        if (count == 0) return;
+        if (threads <= 1 || count == 1 || insideWorker()) {
+            for (size_t i = 0; i < count; i++) body(i);
+            return;
+        }
+
+        std::lock_guard<std::mutex> guard(loopMutex);
+        startWorkers();
+
+        auto job = std::make_shared<Job>(body, count);
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            current = job;
+            generation++;
+        }
+        wake.notify_all();
+
+        // Nested loops from the caller's own share run serially, like on a worker.
+        insideWorker() = true;
+        job->run();
+        insideWorker() = false;
+
+        std::unique_lock<std::mutex> lock(job->mutex);
+        job->finished.wait(lock, [&] { return job->pending == 0; });
+    }
+
+    ~ThreadPool() {
+        std::lock_guard<std::mutex> guard(loopMutex);
+        stopWorkers();
+    }
+
+private:
+    // One parallelFor call. Workers that wake up late only ever see the
+    // exhausted counter of the job they picked up.
+    struct Job {
+        std::function<void(size_t)> body;
+        size_t size;
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> pending;
+        std::mutex mutex;
+        std::condition_variable finished;
+
+        Job(std::function<void(size_t)> body, size_t size) : body(std::move(body)), size(size), pending(size) {}
+
+        void run() {
+            size_t done = 0;
+            for (size_t i; (i = next.fetch_add(1)) < size; done++) {
+                body(i);
+            }
+            if (done != 0 && pending.fetch_sub(done) == done) {
+                std::lock_guard<std::mutex> lock(mutex);
+                finished.notify_all();
+            }
+        }
+    };
+
+    size_t threads = defaultThreadCount();
+    std::vector<std::thread> workers;
+
+    std::mutex loopMutex;
+    std::mutex stateMutex;
+    std::condition_variable wake;
+    std::shared_ptr<Job> current;
+    size_t generation = 0;
+    bool stopping = false;
+
+    ThreadPool() = default;
+
+    static size_t defaultThreadCount() {
+        return std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+
+    static bool& insideWorker() {
+        thread_local bool inside = false;
+        return inside;
+    }
+
+    void startWorkers() {
+        if (!workers.empty()) return;
+        stopping = false;
+        for (size_t i = 1; i < threads; i++) {
+            workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    void stopWorkers() {
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            stopping = true;
+            current.reset();
+        }
+        wake.notify_all();
+        for (auto& worker : workers) worker.join();
+        workers.clear();
+    }
+
+    void workerLoop() {
+        insideWorker() = true;
+        size_t seen = 0;
+        while (true) {
+            std::shared_ptr<Job> job;
+            {
+                std::unique_lock<std::mutex> lock(stateMutex);
+                wake.wait(lock, [&] { return stopping || (current && generation != seen); });
+                if (stopping) return;
+                seen = generation;
+                job = current;
+            }
+            job->run();
+        }
+    }
+};
+
+#endif
@@ -3,13 +3,17 @@
 
 #include "../parser/errors.hpp"
 #include "../parser/value.hpp"
+#include "dict.hpp"
+#include "array.hpp"
 #include "../std/std.hpp"
 #include "../utils/utils.hpp"
 #include "../bytecode/codegen.hpp"
+#include "../bytecode/assembler.hpp"
 #include <vector>
 #include <map>
 #include <stack>
 #include <stdexcept>
+#include <cmath>
 #include <sstream>
 #include <cstdlib>
 #include <ctime>
@@ -20,12 +24,12 @@ public:
     struct Frame {
         std::map<std::string, Value> locals;
         Frame* parent;
-        BytecodeProgram program;
+        std::shared_ptr<CompiledProgram> program;
         size_t pc;
         Value returnValue;
 
-        Frame(const BytecodeProgram& program, Frame* parent = nullptr)
-                : program(program), pc(0), parent(parent) {}
+        Frame(std::shared_ptr<CompiledProgram> program, Frame* parent = nullptr)
+                : program(std::move(program)), pc(0), parent(parent) {}
     };
 
     std::stack<Frame> frames;
@@ -33,6 +37,28 @@ public:
     std::map<std::string, FunctionDeclaration*> functions;
     std::map<std::string, Value> consts;
 
+    bool collectOpStats = false;
+    std::map<uint64_t, size_t> opSequenceCounts;
+
+    void dumpOpStats(std::ostream& out, size_t limit = 40) {
+        std::vector<std::pair<size_t, uint64_t>> sequences;
+        for (const auto& entry : opSequenceCounts) {
+            sequences.push_back({entry.second, entry.first});
+        }
+        std::sort(sequences.rbegin(), sequences.rend());
+
+        out << "Dynamic opcode sequences (count, length, ops):" << std::endl;
+        for (size_t i = 0; i < sequences.size() && i < limit; i++) {
+            uint64_t key = sequences[i].second;
+            size_t length = key >> 32;
+            out << std::setw(12) << sequences[i].first << "  " << length << " ";
+            for (size_t k = length; k-- > 0;) {
+                out << " " << opcodeName((BytecodeOp)(((key >> (k * 8)) & 0xFF) - 1));
+            }
+            out << std::endl;
+        }
+    }
+
     void printFrameStack() {
         std::stack<Frame> tempFrames = frames;
         int frameIndex = tempFrames.size() - 1;
@@ -62,54 +88,12 @@ public:
 
 
             std::cout << "  Program:" << std::endl;
-            for (size_t i = 0; i < frame.program.size(); ++i) {
-                const Bytecode& instr = frame.program[i];
-                std::cout << "    " << std::setw(4) << i << ": ";
-                switch (instr.op) {
-                    case LOAD_CONST: std::cout << "LOAD_CONST"; break;
-                    case LOAD_VAR: std::cout << "LOAD_VAR"; break;
-                    case STORE_VAR: std::cout << "STORE_VAR"; break;
-                    case BINARY_OP: std::cout << "BINARY_OP"; break;
-                    case JUMP: std::cout << "JUMP"; break;
-                    case JUMP_IF_FALSE: std::cout << "JUMP_IF_FALSE"; break;
-                    case CALL_FUNCTION: std::cout << "CALL_FUNCTION"; break;
-                    case BUILD_LIST: std::cout << "BUILD_LIST"; break;
-                    case POP: std::cout << "POP"; break;
-                    case RETURN: std::cout << "RETURN"; break;
-                    case LOAD_SUBSCRIPT: std::cout << "LOAD_SUBSCRIPT"; break;
-                    case STORE_SUBSCRIPT: std::cout << "STORE_SUBSCRIPT"; break;
-                    case CREATE_OBJECT: std::cout << "CREATE_OBJECT"; break;
-                    case LOAD_MEMBER: std::cout << "LOAD_MEMBER"; break;
-                    case STORE_MEMBER: std::cout << "STORE_MEMBER"; break;
-                    case LOAD_FUNC: std::cout << "LOAD_FUNC"; break;
-                    case STORE_MEMBER_FUNC: std::cout << "STORE_MEMBER_FUNC"; break;
-                    // case CLEAR: std::cout << "CLEAR"; break;
-                    default: std::cout << "Unknown opcode"; break;
-                }
-                try{
-                    if (!std::get<std::string>(instr.operand).empty()) {
-                        std::cout << " " << std::get<std::string>(instr.operand);
-                    }
-                } catch(...) {
-
-                }
-
-                try{
-                    if (std::get<BigNum>(instr.operand)!= 0) {
-                        std::cout << " " << std::get<BigNum>(instr.operand).get_ll();
-                    }
-                } catch(...) {
-
+            const std::vector<InstructionWord>& code = frame.program->code;
+            for (size_t i = 0; i < code.size(); i += instructionWords(instructionOp(code[i]))) {
+                std::cout << "    " << std::setw(4) << i << ": " << opcodeName(instructionOp(code[i]));
+                for (size_t k = 0; k < instructionWords(instructionOp(code[i])); k++) {
+                    std::cout << " " << (k == 0 ? instructionOperand(code[i]) : code[i + k]);
                 }
-
-                try{
-                    if (!std::get<CallFunctionOperand>(instr.operand).funcName.empty()) {
-                        std::cout << " " << std::get<CallFunctionOperand>(instr.operand).funcName;
-                    }
-                } catch(...) {
-
-                }
-
                 std::cout << std::endl;
             }
 
@@ -142,26 +126,42 @@ public:
         }
 
         Frame& currentFrame = frames.top();
+        uint32_t opHistory = 0;
 
-        while (currentFrame.pc < currentFrame.program.size()) {
-            const Bytecode& instr = currentFrame.program[currentFrame.pc];
+        while (currentFrame.pc < currentFrame.program->code.size()) {
+            CompiledProgram& program = *currentFrame.program;
+            std::vector<InstructionWord>& code = program.code;
+            const size_t pc = currentFrame.pc;
+            const BytecodeOp op = instructionOp(code[pc]);
+            const uint32_t arg = instructionOperand(code[pc]);
 
         //    printFrameStack();
 
+            if (collectOpStats) recordOpSequence(op, opHistory);
+
             try {
-                switch (instr.op) {
-                    case LOAD_CONST: handleLoadConst(instr); break;
-                    case LOAD_VAR: handleLoadVar(instr, currentFrame); break;
-                    case STORE_VAR: handleStoreVar(instr, currentFrame); break;
-                    case BINARY_OP: handleBinaryOp(instr); break;
-                    case JUMP: currentFrame.pc = handleJump(instr); continue;
-                    case JUMP_IF_FALSE: currentFrame.pc = handleJumpIfFalse(instr, currentFrame.pc); continue;
-                    case CALL_FUNCTION: handleCallFunction(instr, currentFrame); break;
-                    case BUILD_LIST: handleBuildList(instr); break;
+                switch (op) {
+                    case LOAD_CONST: operandStack.push(program.constants[arg]); break;
+                    case LOAD_VAR: operandStack.push(lookupVar(program.names[arg], currentFrame)); break;
+                    case STORE_VAR: handleStoreVar(program.names[arg], currentFrame); break;
+                    case STORE_VAR_KEEP: handleStoreVarKeep(program.names[arg], currentFrame); break;
+                    case BINARY_OP: handleBinaryOp(code[pc]); break;
+                    case JUMP: currentFrame.pc = arg; continue;
+                    case JUMP_IF_FALSE: currentFrame.pc = handleJumpIfFalse(arg, pc + 1); continue;
+                    case CALL_FUNCTION: handleCallFunction(program.calls[arg], currentFrame); break;
+                    case TAIL_CALL:
+                        if (handleTailCall(program.calls[arg], currentFrame)) continue;
+                        break;
+                    case BUILD_LIST: handleBuildList(arg); break;
+                    case BUILD_DICT: handleBuildDict(arg); break;
+                    case CONCAT_N: handleConcat(arg); break;
                     case POP: operandStack.pop(); break;
                     case RETURN: handleReturn(currentFrame); break;
-                    case LOAD_SUBSCRIPT: handleLoadSubscript(); break;
+                    case LOAD_SUBSCRIPT: handleLoadSubscript(code[pc]); break;
                     case STORE_SUBSCRIPT: handleStoreSubscript(); break;
+                    case STORE_SUBSCRIPT_VAR: handleStoreSubscriptVar(program.names[arg], currentFrame); break;
+                    case SLICE: handleSlice(); break;
+                    case ADD_VAR: handleAddVar(program.names[arg], currentFrame); break;
                     case CREATE_OBJECT: {
                         Value obj;
                         obj.type = Value::OBJECT;
@@ -170,7 +170,7 @@ public:
                         break;
                     }
                     case LOAD_FUNC: {
-                        std::string funcName = std::get<std::string>(instr.operand);
+                        const std::string& funcName = program.names[arg];
                         if (functions.count(funcName)) {
                             Value funcValue;
                             funcValue.type = Value::OBJECT;
@@ -208,7 +208,7 @@ public:
                         break;
                     }
                     case STORE_MEMBER: {
-                        std::string member = std::get<std::string>(instr.operand);
+                        const std::string& member = program.names[arg];
                         if (operandStack.size() < 2) {
                             throwRuntimeError("Stack underflow in STORE_MEMBER");
                         }
@@ -224,7 +224,7 @@ public:
                         break;
                     }
                     case LOAD_MEMBER: {
-                        std::string member = std::get<std::string>(instr.operand);
+                        const std::string& member = program.names[arg];
                         Value obj = operandStack.top();
                         operandStack.pop();
 
@@ -242,9 +242,111 @@ public:
                     //     break;
                     // }
                     case LABEL: break;
+                    case LOAD_VAR_CONST_BINARY: {
+                        operandStack.push(feedbackBinaryOp(lookupVar(program.names[arg], currentFrame),
+                                                           program.constants[code[pc + 1]], code[pc + 2]));
+                        break;
+                    }
+                    case LOAD_VAR_VAR_BINARY: {
+                        operandStack.push(feedbackBinaryOp(lookupVar(program.names[arg], currentFrame),
+                                                           lookupVar(program.names[code[pc + 1]], currentFrame),
+                                                           code[pc + 2]));
+                        break;
+                    }
+                    case LOAD_VAR_VAR_SUBSCRIPT: {
+                        operandStack.push(subscript(lookupVar(program.names[arg], currentFrame),
+                                                    lookupVar(program.names[code[pc + 1]], currentFrame)));
+                        break;
+                    }
+                    case LOAD_VAR_CONST_BINARY_STORE: {
+                        Value result = feedbackBinaryOp(lookupVar(program.names[arg], currentFrame),
+                                                        program.constants[code[pc + 1]], code[pc + 2]);
+                        if (code[pc + 4]) operandStack.push(result);
+                        currentFrame.locals[program.names[code[pc + 3]]] = std::move(result);
+                        break;
+                    }
+                    case LOAD_VAR_CONST_BINARY_JUMP: {
+                        Value cond = feedbackBinaryOp(lookupVar(program.names[arg], currentFrame),
+                                                      program.constants[code[pc + 1]], code[pc + 2]);
+                        currentFrame.pc = branchIfFalse(cond, code[pc + 3], pc + 4);
+                        continue;
+                    }
+                    case BINARY_OP_STORE: {
+                        handleFeedbackBinaryOp(code[pc]);
+                        if (code[pc + 2]) handleStoreVarKeep(program.names[code[pc + 1]], currentFrame);
+                        else handleStoreVar(program.names[code[pc + 1]], currentFrame);
+                        break;
+                    }
+                    case BINARY_OP_JUMP_IF_FALSE: {
+                        handleFeedbackBinaryOp(code[pc]);
+                        currentFrame.pc = handleJumpIfFalse(code[pc + 1], pc + 2);
+                        continue;
+                    }
+                    case ADD_NUM_NUM:
+                        quickBinaryOp(code[pc], Value::NUMBER, [](const Value& l, const Value& r) { return Value(l.bignumValue + r.bignumValue); });
+                        break;
+                    case SUB_NUM_NUM:
+                        quickBinaryOp(code[pc], Value::NUMBER, [](const Value& l, const Value& r) { return Value(l.bignumValue - r.bignumValue); });
+                        break;
+                    case MUL_NUM_NUM:
+                        quickBinaryOp(code[pc], Value::NUMBER, [](const Value& l, const Value& r) { return Value(l.bignumValue * r.bignumValue); });
+                        break;
+                    case LT_NUM_NUM:
+                        quickBinaryOp(code[pc], Value::NUMBER, [](const Value& l, const Value& r) { return boolean(l.bignumValue < r.bignumValue); });
+                        break;
+                    case LE_NUM_NUM:
+                        quickBinaryOp(code[pc], Value::NUMBER, [](const Value& l, const Value& r) { return boolean(l.bignumValue <= r.bignumValue); });
+                        break;
+                    case GT_NUM_NUM:
+                        quickBinaryOp(code[pc], Value::NUMBER, [](const Value& l, const Value& r) { return boolean(l.bignumValue > r.bignumValue); });
+                        break;
+                    case GE_NUM_NUM:
+                        quickBinaryOp(code[pc], Value::NUMBER, [](const Value& l, const Value& r) { return boolean(l.bignumValue >= r.bignumValue); });
+                        break;
+                    case EQ_NUM_NUM:
+                        quickBinaryOp(code[pc], Value::NUMBER, [](const Value& l, const Value& r) { return boolean(l.bignumValue == r.bignumValue); });
+                        break;
+                    case NE_NUM_NUM:
+                        quickBinaryOp(code[pc], Value::NUMBER, [](const Value& l, const Value& r) { return boolean(l.bignumValue != r.bignumValue); });
+                        break;
+                    case ADD_FLOAT_FLOAT:
+                    case SUB_FLOAT_FLOAT:
+                    case MUL_FLOAT_FLOAT:
+                    case DIV_FLOAT_FLOAT:
+                    case LT_FLOAT_FLOAT:
+                    case LE_FLOAT_FLOAT:
+                    case GT_FLOAT_FLOAT:
+                    case GE_FLOAT_FLOAT:
+                    case EQ_FLOAT_FLOAT:
+                    case NE_FLOAT_FLOAT:
+                        quickFloatOp(code[pc]);
+                        break;
+                    case ADD_STR_STR:
+                        quickBinaryOp(code[pc], Value::STRING, [](const Value& l, const Value& r) { return Value(l.strValue + r.strValue); });
+                        break;
+                    case LOAD_SUBSCRIPT_LIST_NUM: {
+                        if (operandStack.size() < 2) throwRuntimeError("Stack underflow");
+                        Value index = std::move(operandStack.top()); operandStack.pop();
+                        Value& list = operandStack.top();
+                        if (list.type != Value::LIST || index.type != Value::NUMBER) {
+                            code[pc] = encodeInstruction(LOAD_SUBSCRIPT);
+                        }
+                        list = subscript(list, index);
+                        break;
+                    }
+                    case LOAD_SUBSCRIPT_DICT: {
+                        if (operandStack.size() < 2) throwRuntimeError("Stack underflow");
+                        Value key = std::move(operandStack.top()); operandStack.pop();
+                        Value& dict = operandStack.top();
+                        if (dict.type != Value::DICT) {
+                            code[pc] = encodeInstruction(LOAD_SUBSCRIPT);
+                        }
+                        dict = subscript(dict, key);
+                        break;
+                    }
                     default: throwRuntimeError("Unknown bytecode instruction");
                 }
-                currentFrame.pc++;
+                currentFrame.pc += instructionWords(op);
             } catch (const std::runtime_error& e) {
                 if (frames.size() > 1) {
                     frames.pop();
@@ -257,25 +359,61 @@ public:
     }
 
 private:
-    void handleLoadConst(const Bytecode& instr) {
-        if (auto ival = std::get_if<BigNum>(&instr.operand)) {
-            operandStack.push(Value(*ival));
-        } else if (auto sval = std::get_if<std::string>(&instr.operand)) {
-            operandStack.push(Value(*sval));
-        } else {
-            operandStack.push(Value());
+    // Counts the 2-, 3- and 4-instruction windows of the executed opcode
+    // stream; used to pick the superinstructions fused by the Optimizer.
+    void recordOpSequence(BytecodeOp op, uint32_t& history) {
+        history = (history << 8) | ((uint32_t)op + 1);
+        for (uint64_t length = 2; length <= 4; length++) {
+            uint32_t window = length == 4 ? history : history & ((1u << (length * 8)) - 1);
+            if (window >> ((length - 1) * 8) == 0) break;
+            opSequenceCounts[(length << 32) | window]++;
+        }
+    }
+
+    Value subscript(const Value& list, const Value& index) {
+        if (list.type == Value::DICT) {
+            const Value* value = list.dictValue->find(index);
+            if (value == nullptr) throwIndexError("Key not found in dict");
+            return *value;
+        }
+        if (list.type != Value::LIST && list.type != Value::ARRAY) throwTypeError("Expected list");
+        if (index.type != Value::NUMBER) throwTypeError("Index must be number");
+        const BigNum& idx = index.bignumValue;
+        if (list.type == Value::ARRAY) {
+            if (idx < 0 || idx >= list.arrayValue->size()) throwIndexError("Index out of range");
+            return list.arrayValue->at(idx.get_ll());
         }
+        if (idx < 0 || idx >= list.listValue.size()) throwIndexError("Index out of range");
+        return list.listValue.at(idx.get_ll());
     }
 
-    void handleLoadSubscript() {
+    void handleLoadSubscript(InstructionWord& word) {
         if (operandStack.size() < 2) throwRuntimeError("Stack underflow");
         Value index = operandStack.top(); operandStack.pop();
         Value list = operandStack.top(); operandStack.pop();
-        if (list.type != Value::LIST) throwTypeError("Expected list");
+        operandStack.push(subscript(list, index));
+        if (list.type == Value::LIST && index.type == Value::NUMBER) {
+            word = encodeInstruction(LOAD_SUBSCRIPT_LIST_NUM);
+        } else if (list.type == Value::DICT) {
+            word = encodeInstruction(LOAD_SUBSCRIPT_DICT);
+        }
+    }
+
+    static void storeSubscript(Value& container, const Value& index, Value value) {
+        if (container.type == Value::DICT) {
+            mutableDict(container).insert(index, std::move(value));
+            return;
+        }
+        if (container.type != Value::LIST && container.type != Value::ARRAY) throwTypeError("Expected list");
         if (index.type != Value::NUMBER) throwTypeError("Index must be number");
-        BigNum idx = index.bignumValue;
-        if (idx < 0 || idx >= list.listValue.size()) throwIndexError("Index out of range");
-        operandStack.push(list.listValue[idx.get_ll()]);
+        const BigNum& idx = index.bignumValue;
+        if (container.type == Value::ARRAY) {
+            if (idx < 0 || idx >= container.arrayValue->size()) throwIndexError("Index out of range");
+            mutableArray(container).set(idx.get_ll(), value);
+            return;
+        }
+        if (idx < 0 || idx >= container.listValue.size()) throwIndexError("Index out of range");
+        container.listValue.set(idx.get_ll(), std::move(value));
     }
 
     void handleStoreSubscript() {
@@ -283,60 +421,332 @@ private:
         Value value = operandStack.top(); operandStack.pop();
         Value index = operandStack.top(); operandStack.pop();
         Value list = operandStack.top(); operandStack.pop();
-        if (list.type != Value::LIST) throwTypeError("Expected list");
-        if (index.type != Value::NUMBER) throwTypeError("Index must be number");
-        BigNum idx = index.bignumValue;
-        if (idx < 0 || idx >= list.listValue.size()) throwIndexError("Index out of range");
-        list.listValue[idx.get_ll()] = value;
+        storeSubscript(list, index, std::move(value));
         operandStack.push(list);
     }
 
-    void handleLoadVar(const Bytecode& instr, Frame& frame) {
-        const std::string& name = std::get<std::string>(instr.operand);
+    // A slice bound as an offset into a sequence of the given length:
+    // negative bounds count from the end and anything outside is clamped.
+    static size_t sliceBound(const Value& bound, size_t length, size_t missing) {
+        if (bound.type == Value::NULL_TYPE) return missing;
+        if (bound.type != Value::NUMBER) throwTypeError("Slice bounds must be numbers");
+        BigNum pos = bound.bignumValue;
+        if (pos < 0) pos = pos + BigNum(length);
+        if (pos < 0) return 0;
+        if (pos >= length) return length;
+        return pos.get_ll();
+    }
+
+    // xs[a:b]: a list slice shares the elements of the list, a string
+    // slice is cut out of the string copy already on the stack.
+    void handleSlice() {
+        if (operandStack.size() < 3) throwRuntimeError("Stack underflow");
+        Value end = std::move(operandStack.top()); operandStack.pop();
+        Value start = std::move(operandStack.top()); operandStack.pop();
+        Value& target = operandStack.top();
+        size_t length;
+        if (target.type == Value::LIST) {
+            length = target.listValue.size();
+        } else if (target.type == Value::STRING) {
+            length = target.strValue.size();
+        } else {
+            throwTypeError("Expected list or string to slice");
+        }
+        size_t from = sliceBound(start, length, 0);
+        size_t to = std::max(from, sliceBound(end, length, length));
+        if (target.type == Value::LIST) {
+            target.listValue = target.listValue.slice(from, to);
+        } else {
+            target.strValue.erase(to);
+            target.strValue.erase(0, from);
+        }
+    }
+
+    // The variable as STORE_VAR would write it: a variable of an enclosing
+    // frame is copied into the current one first.
+    Value& localVar(const std::string& name, Frame& frame) {
+        auto it = frame.locals.find(name);
+        if (it == frame.locals.end()) {
+            Value outer = lookupVar(name, frame);
+            it = frame.locals.emplace(name, std::move(outer)).first;
+        }
+        return it->second;
+    }
+
+    // x[i] = v updates the variable in place rather than copying the whole
+    // container through the stack.
+    void handleStoreSubscriptVar(const std::string& name, Frame& frame) {
+        if (operandStack.size() < 2) throwRuntimeError("Stack underflow");
+        Value value = std::move(operandStack.top()); operandStack.pop();
+        Value index = std::move(operandStack.top()); operandStack.pop();
+        storeSubscript(localVar(name, frame), index, std::move(value));
+    }
+
+    // x = x + e with e on the stack. Strings are appended in place, so
+    // building a string piece by piece is linear instead of quadratic.
+    void handleAddVar(const std::string& name, Frame& frame) {
+        if (operandStack.empty()) throwRuntimeError("Stack underflow");
+        Value right = std::move(operandStack.top()); operandStack.pop();
+        Value& target = localVar(name, frame);
+        if (target.type == Value::STRING && right.type == Value::STRING) {
+            target.strValue += right.strValue;
+        } else if (target.type == Value::NUMBER && right.type == Value::NUMBER) {
+            target.bignumValue = target.bignumValue + right.bignumValue;
+        } else if (target.type == Value::FLOAT && right.type == Value::FLOAT) {
+            target.floatValue += right.floatValue;
+        } else {
+            target = binaryOp(target, right, OP_ADD);
+        }
+    }
+
+    Value& lookupVar(const std::string& name, Frame& frame) {
         Frame* currentFrame = &frame;
 
 
         while (currentFrame != nullptr) {
-            if (currentFrame->locals.count(name)) {
-                operandStack.push(currentFrame->locals[name]);
-                return;
+            auto it = currentFrame->locals.find(name);
+            if (it != currentFrame->locals.end()) {
+                return it->second;
             }
             currentFrame = currentFrame->parent;
         }
 
 
         throwIdentifierError("Undefined variable '" + name + "'");
+        return frame.returnValue;
     }
 
-    void handleStoreVar(const Bytecode& instr, Frame& frame) {
-        const std::string& name = std::get<std::string>(instr.operand);
+    void handleStoreVar(const std::string& name, Frame& frame) {
         if (operandStack.empty()) {
             throwRuntimeError("Stack underflow in store operation");
         }
-        Value value = operandStack.top();
+        Value& value = operandStack.top();
+        Value& slot = frame.locals[name];
+        if (slot.type == Value::FLOAT && value.type == Value::FLOAT) {
+            slot.floatValue = value.floatValue;
+        } else {
+            slot = std::move(value);
+        }
         operandStack.pop();
-        frame.locals[name] = value;
     }
 
-    void handleBinaryOp(const Bytecode& instr) {
+    void handleStoreVarKeep(const std::string& name, Frame& frame) {
+        if (operandStack.empty()) {
+            throwRuntimeError("Stack underflow in store operation");
+        }
+        frame.locals[name] = operandStack.top();
+    }
+
+    // Generic BINARY_OP. Rewrites itself into the specialized opcode for the
+    // operand types it just saw; see quickBinaryOp for the way back.
+    void handleBinaryOp(InstructionWord& word) {
         if (operandStack.size() < 2) {
             throwRuntimeError("Stack underflow in binary operation");
         }
-        Value right = operandStack.top(); operandStack.pop();
-        Value left = operandStack.top(); operandStack.pop();
-        std::string op = std::get<std::string>(instr.operand);
+        BinaryOperator op = (BinaryOperator)instructionOperand(word);
+        Value right = std::move(operandStack.top()); operandStack.pop();
+        Value& left = operandStack.top();
+        BytecodeOp quickened = quickenedOp(op, left, right);
+        left = binaryOp(left, right, op);
+        if (quickened != BINARY_OP) word = encodeInstruction(quickened, op);
+    }
 
-        if (op == "+") {
-            if (left.type == Value::STRING && right.type == Value::STRING) {
-                operandStack.push(Value(left.strValue + right.strValue));
-            } else if (left.type == Value::NUMBER && right.type == Value::NUMBER) {
-                BigNum result = left.bignumValue + right.bignumValue;
-                operandStack.push(Value(result));
-            } else {
-                throwRuntimeError("Cannot add incompatible types");
+    static BytecodeOp quickenedOp(BinaryOperator op, const Value& left, const Value& right) {
+        if (left.type == Value::STRING && right.type == Value::STRING) {
+            return op == OP_ADD ? ADD_STR_STR : BINARY_OP;
+        }
+        if (left.type == Value::FLOAT && right.type == Value::FLOAT) {
+            switch (op) {
+                case OP_ADD: return ADD_FLOAT_FLOAT;
+                case OP_SUB: return SUB_FLOAT_FLOAT;
+                case OP_MUL: return MUL_FLOAT_FLOAT;
+                case OP_DIV: return DIV_FLOAT_FLOAT;
+                case OP_LT: return LT_FLOAT_FLOAT;
+                case OP_LE: return LE_FLOAT_FLOAT;
+                case OP_GT: return GT_FLOAT_FLOAT;
+                case OP_GE: return GE_FLOAT_FLOAT;
+                case OP_EQ: return EQ_FLOAT_FLOAT;
+                case OP_NE: return NE_FLOAT_FLOAT;
+                default: return BINARY_OP;
+            }
+        }
+        if (left.type != Value::NUMBER || right.type != Value::NUMBER) return BINARY_OP;
+        switch (op) {
+            case OP_ADD: return ADD_NUM_NUM;
+            case OP_SUB: return SUB_NUM_NUM;
+            case OP_MUL: return MUL_NUM_NUM;
+            case OP_LT: return LT_NUM_NUM;
+            case OP_LE: return LE_NUM_NUM;
+            case OP_GT: return GT_NUM_NUM;
+            case OP_GE: return GE_NUM_NUM;
+            case OP_EQ: return EQ_NUM_NUM;
+            case OP_NE: return NE_NUM_NUM;
+            default: return BINARY_OP;
+        }
+    }
+
+    // Specialized BINARY_OP: skips the type dispatch while both operands have
+    // the expected type, otherwise deoptimizes the word back to BINARY_OP.
+    template<typename F>
+    void quickBinaryOp(InstructionWord& word, Value::ValueType type, F f) {
+        if (operandStack.size() < 2) {
+            throwRuntimeError("Stack underflow in binary operation");
+        }
+        Value right = std::move(operandStack.top()); operandStack.pop();
+        Value& left = operandStack.top();
+        if (left.type == type && right.type == type) {
+            left = f(left, right);
+            return;
+        }
+        BinaryOperator op = (BinaryOperator)instructionOperand(word);
+        word = encodeInstruction(BINARY_OP, op);
+        left = binaryOp(left, right, op);
+    }
+
+    // *_FLOAT_FLOAT: the right operand is read as a double and the result is
+    // written into the left operand's stack slot, so no Value is built or
+    // moved while both sides stay floats.
+    void quickFloatOp(InstructionWord& word) {
+        if (operandStack.size() < 2) {
+            throwRuntimeError("Stack underflow in binary operation");
+        }
+        BinaryOperator op = (BinaryOperator)instructionOperand(word);
+        if (operandStack.top().type == Value::FLOAT) {
+            double right = operandStack.top().floatValue;
+            operandStack.pop();
+            Value& left = operandStack.top();
+            if (left.type == Value::FLOAT) {
+                storeFloatOp(left, left.floatValue, right, op);
+                return;
             }
-        } else if (op == "-" || op == "*" || op == "/" || op == "%" || op == "^" || op == "|" || op == "&" || op == "~") {
-            if (op == "*") {
+            operandStack.push(Value(right));
+        }
+        word = encodeInstruction(BINARY_OP, op);
+        Value right = std::move(operandStack.top()); operandStack.pop();
+        Value& left = operandStack.top();
+        left = binaryOp(left, right, op);
+    }
+
+    // slot = left op right for the operators that have a *_FLOAT_FLOAT form;
+    // a float slot keeps its Value and only has its double replaced.
+    static void storeFloatOp(Value& slot, double left, double right, BinaryOperator op) {
+        double result;
+        switch (op) {
+            case OP_ADD: result = left + right; break;
+            case OP_SUB: result = left - right; break;
+            case OP_MUL: result = left * right; break;
+            case OP_DIV: result = left / right; break;
+            default:
+                slot = boolean(compare(left, right, op));
+                return;
+        }
+        if (slot.type == Value::FLOAT) slot.floatValue = result;
+        else slot = Value(result);
+    }
+
+    // Superinstructions cannot change opcode per operator, so their operator
+    // operand carries the feedback instead: OPERATOR_QUICK_NUM is set once
+    // both operands were numbers and cleared again on the first miss. Two
+    // floats need no feedback and go straight to floatOp.
+    Value feedbackBinaryOp(const Value& left, const Value& right, uint32_t& operand) {
+        BinaryOperator op = operandOperator(operand);
+        if (left.type == Value::FLOAT && right.type == Value::FLOAT) {
+            return floatOp(left.floatValue, right.floatValue, op);
+        }
+        bool numbers = left.type == Value::NUMBER && right.type == Value::NUMBER;
+        if (operand & OPERATOR_QUICK_NUM) {
+            if (numbers) return numberOp(left.bignumValue, right.bignumValue, op);
+            operand &= ~OPERATOR_QUICK_NUM;
+        } else if (numbers && quickenedOp(op, left, right) != BINARY_OP) {
+            operand |= OPERATOR_QUICK_NUM;
+        }
+        return binaryOp(left, right, op);
+    }
+
+    void handleFeedbackBinaryOp(InstructionWord& word) {
+        if (operandStack.size() < 2) {
+            throwRuntimeError("Stack underflow in binary operation");
+        }
+        uint32_t operand = instructionOperand(word);
+        Value right = std::move(operandStack.top()); operandStack.pop();
+        Value& left = operandStack.top();
+        BinaryOperator op = operandOperator(operand);
+        if (left.type == Value::FLOAT && right.type == Value::FLOAT && quickenedOp(op, left, right) != BINARY_OP) {
+            storeFloatOp(left, left.floatValue, right.floatValue, op);
+            return;
+        }
+        left = feedbackBinaryOp(left, right, operand);
+        word = encodeInstruction(instructionOp(word), operand);
+    }
+
+    static Value numberOp(const BigNum& left, const BigNum& right, BinaryOperator op) {
+        switch (op) {
+            case OP_ADD: return Value(left + right);
+            case OP_SUB: return Value(left - right);
+            case OP_MUL: return Value(left * right);
+            default: return boolean(compare(left, right, op));
+        }
+    }
+
+    static Value boolean(bool result) {
+        return Value(BigNum(result ? 1 : 0));
+    }
+
+    static bool isFalse(const Value& value) {
+        if (value.type == Value::FLOAT) return value.floatValue == 0;
+        return value.bignumValue == 0;
+    }
+
+    static bool isNumeric(const Value& value) {
+        return value.type == Value::NUMBER || value.type == Value::FLOAT;
+    }
+
+    static double toFloat(const Value& value) {
+        return value.type == Value::FLOAT ? value.floatValue : value.bignumValue.to_double();
+    }
+
+    // A FLOAT operand promotes the other (NUMBER) operand to a double.
+    // Floats follow IEEE 754: division by zero yields inf or nan.
+    static Value floatOp(double left, double right, BinaryOperator op) {
+        switch (op) {
+            case OP_ADD: return Value(left + right);
+            case OP_SUB: return Value(left - right);
+            case OP_MUL: return Value(left * right);
+            case OP_DIV: return Value(left / right);
+            case OP_MOD: return Value(std::fmod(left, right));
+            case OP_POW: return Value(std::pow(left, right));
+            case OP_AND: return boolean(left != 0 && right != 0);
+            case OP_OR: return boolean(left != 0 || right != 0);
+            case OP_LT:
+            case OP_LE:
+            case OP_EQ:
+            case OP_NE:
+            case OP_GT:
+            case OP_GE:
+                return boolean(compare(left, right, op));
+            default:
+                throwRuntimeError(std::string("Operator ") + binaryOperatorSymbol(op) + " requires numbers");
+        }
+        return Value();
+    }
+
+    Value binaryOp(const Value& left, const Value& right, BinaryOperator op) {
+        if (left.type == Value::ARRAY || right.type == Value::ARRAY) {
+            return arrayBinaryOp(left, right, op);
+        }
+        if ((left.type == Value::FLOAT || right.type == Value::FLOAT) && isNumeric(left) && isNumeric(right)) {
+            return floatOp(toFloat(left), toFloat(right), op);
+        }
+        switch (op) {
+            case OP_ADD:
+                if (left.type == Value::STRING && right.type == Value::STRING) {
+                    return Value(left.strValue + right.strValue);
+                } else if (left.type == Value::NUMBER && right.type == Value::NUMBER) {
+                    return Value(left.bignumValue + right.bignumValue);
+                }
+                throwRuntimeError("Cannot add incompatible types");
+                break;
+            case OP_MUL:
                 if ((left.type == Value::STRING && right.type == Value::NUMBER) || (right.type == Value::STRING && left.type == Value::NUMBER)) {
                     std::string result;
                     auto times = right.bignumValue.get_ll();
@@ -344,123 +754,203 @@ private:
                     for (long long i = 0; i < times; i++) {
                         result += left.strValue;
                     }
-                    operandStack.push(Value(result));
+                    return Value(result);
                 } else if ((left.type == Value::LIST && right.type == Value::NUMBER) || (right.type == Value::LIST && left.type == Value::NUMBER)) {
-                    std::vector<Value> result;
+                    const List& items = left.listValue;
                     auto times = right.bignumValue.get_ll();
                     if (times < 0) throwRuntimeError("Cannot multiply list by negative number");
+                    if (items.kind() == List::SMALL_INT) {
+                        std::vector<int64_t> result;
+                        for (long long i = 0; i < times; i++) {
+                            result.insert(result.end(), items.ints(), items.ints() + items.size());
+                        }
+                        return Value(List(std::move(result)));
+                    }
+                    std::vector<Value> result;
                     for (long long i = 0; i < times; i++) {
-                        result.insert(result.end(), left.listValue.begin(), left.listValue.end());
+                        items.forEach([&](const Value& item) { result.push_back(item); });
                     }
-                    operandStack.push(Value(result));
+                    return Value(std::move(result));
                 } else if (left.type == Value::NUMBER && right.type == Value::NUMBER) {
-                    operandStack.push(Value(left.bignumValue * right.bignumValue));
-                } else {
-                    throwRuntimeError("Invalid operand types for multiplication");
+                    return Value(left.bignumValue * right.bignumValue);
+                }
+                throwRuntimeError("Invalid operand types for multiplication");
+                break;
+            case OP_SUB:
+            case OP_DIV:
+            case OP_MOD:
+            case OP_POW:
+            case OP_BIT_OR:
+            case OP_BIT_AND:
+            case OP_BIT_NOT: {
+                if (left.type != Value::NUMBER || right.type != Value::NUMBER) {
+                    throwRuntimeError(std::string("Operator ") + binaryOperatorSymbol(op) + " requires numbers");
                 }
-            } else if (left.type != Value::NUMBER || right.type != Value::NUMBER) {
-                throwRuntimeError("Operator " + op + " requires numbers");
-            } else {
                 BigNum result;
-                if (op == "-") result = left.bignumValue - right.bignumValue;
-                else if (op == "/") result = left.bignumValue / right.bignumValue;
-                else if (op == "%") result = left.bignumValue % right.bignumValue;
-                else if (op == "^") result = left.bignumValue.pow(right.bignumValue);
-                else if (op == "|") result = left.bignumValue.get_ll() | right.bignumValue.get_ll();
-                else if (op == "&") result = left.bignumValue.get_ll() & right.bignumValue.get_ll();
-                else if (op == "~") result = ~right.bignumValue.get_ll();
-                operandStack.push(Value(result));
-            }
-        } else if (op == "<" || op == "<=" || op == "==" ||
-                  op == "!=" || op == ">" || op == ">=") {
-            auto handle_compare = [&](auto cmp) {
-                bool result = cmp(left, right);
-                operandStack.push(Value(BigNum(result ? 1 : 0)));
-            };
-            if (left.type == Value::STRING && right.type == Value::STRING) {
-                if (op == "<") handle_compare([](auto& l, auto& r){ return l.strValue < r.strValue; });
-                else if (op == ">") handle_compare([](auto& l, auto& r){ return l.strValue > r.strValue; });
-                else if (op == "<=") handle_compare([](auto& l, auto& r){ return l.strValue <= r.strValue; });
-                else if (op == ">=") handle_compare([](auto& l, auto& r){ return l.strValue >= r.strValue; });
-                else if (op == "==") handle_compare([](auto& l, auto& r){ return l.strValue == r.strValue; });
-                else if (op == "!=") handle_compare([](auto& l, auto& r){ return l.strValue != r.strValue; });
-            } else if (left.type == Value::NUMBER && right.type == Value::NUMBER) {
-                if (op == "<") handle_compare([](auto& l, auto& r){ return l.bignumValue < r.bignumValue; });
-                else if (op == ">") handle_compare([](auto& l, auto& r){ return l.bignumValue > r.bignumValue; });
-                else if (op == "<=") handle_compare([](auto& l, auto& r){ return l.bignumValue <= r.bignumValue; });
-                else if (op == ">=") handle_compare([](auto& l, auto& r){ return l.bignumValue >= r.bignumValue; });
-                else if (op == "==") handle_compare([](auto& l, auto& r){ return l.bignumValue == r.bignumValue; });
-                else if (op == "!=") handle_compare([](auto& l, auto& r){ return l.bignumValue != r.bignumValue; });
-            } else if (left.type == Value::NULL_TYPE && right.type == Value::NULL_TYPE) {
-                operandStack.push(Value(BigNum(1))); 
-            }
-            else {
-                operandStack.push(Value(BigNum(0)));
-            }
-        } else if (op == "and" || op == "or") {
-            bool leftValue = left.bignumValue != 0;
-            bool rightValue = right.bignumValue != 0;
-            bool result;
-            if (op == "and") {
-                result = leftValue && rightValue;
-            } else { // op == "or"
-                result = leftValue || rightValue;
+                if (op == OP_SUB) result = left.bignumValue - right.bignumValue;
+                else if (op == OP_DIV) result = left.bignumValue / right.bignumValue;
+                else if (op == OP_MOD) result = left.bignumValue % right.bignumValue;
+                else if (op == OP_POW) result = left.bignumValue.pow(right.bignumValue);
+                else if (op == OP_BIT_OR) result = left.bignumValue.get_ll() | right.bignumValue.get_ll();
+                else if (op == OP_BIT_AND) result = left.bignumValue.get_ll() & right.bignumValue.get_ll();
+                else result = ~right.bignumValue.get_ll();
+                return Value(result);
             }
-            operandStack.push(Value(BigNum(result ? 1 : 0)));
-        } else if (op == "[]") {
-            if (left.type != Value::LIST) {
-                throwTypeError("Expected list for [] operator");
-            }
-            if (right.type != Value::NUMBER) {
-                throwTypeError("Expected number for list index");
-            }
-            BigNum index = right.bignumValue;
-            if (index < 0 || index >= left.listValue.size()) {
-                throwIndexError("List index out of range");
+            case OP_LT:
+            case OP_LE:
+            case OP_EQ:
+            case OP_NE:
+            case OP_GT:
+            case OP_GE:
+                if (left.type == Value::STRING && right.type == Value::STRING) {
+                    return boolean(compare(left.strValue, right.strValue, op));
+                } else if (left.type == Value::NUMBER && right.type == Value::NUMBER) {
+                    return boolean(compare(left.bignumValue, right.bignumValue, op));
+                } else if (left.type == Value::NULL_TYPE && right.type == Value::NULL_TYPE) {
+                    return boolean(true);
+                }
+                return boolean(false);
+            case OP_AND:
+                return boolean(!isFalse(left) && !isFalse(right));
+            case OP_OR:
+                return boolean(!isFalse(left) || !isFalse(right));
+            case OP_IN:
+                if (right.type == Value::SET || right.type == Value::DICT) {
+                    return boolean(right.dictValue->contains(left));
+                }
+                if (right.type == Value::STRING && left.type == Value::STRING) {
+                    return boolean(right.strValue.find(left.strValue) != std::string::npos);
+                }
+                if (right.type == Value::LIST) {
+                    const List& items = right.listValue;
+                    int64_t small;
+                    if (items.kind() == List::SMALL_INT && left.type == Value::NUMBER) {
+                        if (!left.bignumValue.fits_int64(small)) return boolean(false);
+                        return boolean(std::find(items.ints(), items.ints() + items.size(), small) != items.ints() + items.size());
+                    }
+                    return boolean(items.any([&](const Value& item) { return !isFalse(binaryOp(left, item, OP_EQ)); }));
+                }
+                throwTypeError("Operator in expects a set, dict, list or string");
+                break;
+            case OP_INDEX: {
+                if (left.type != Value::LIST) {
+                    throwTypeError("Expected list for [] operator");
+                }
+                if (right.type != Value::NUMBER) {
+                    throwTypeError("Expected number for list index");
+                }
+                const BigNum& index = right.bignumValue;
+                if (index < 0 || index >= left.listValue.size()) {
+                    throwIndexError("List index out of range");
+                }
+                return left.listValue.at(index.get_ll());
             }
-            operandStack.push(left.listValue[index.get_ll()]);
-        } else {
-            throwRuntimeError("Unknown operator: " + op);
+            default:
+                throwRuntimeError(std::string("Unknown operator: ") + binaryOperatorSymbol(op));
         }
+        return Value();
     }
 
-    size_t handleJump(const Bytecode& instr) {
-        return (std::get<BigNum>(instr.operand)).get_ll();
+    template<typename T>
+    static bool compare(const T& left, const T& right, BinaryOperator op) {
+        switch (op) {
+            case OP_LT: return left < right;
+            case OP_LE: return left <= right;
+            case OP_EQ: return left == right;
+            case OP_NE: return left != right;
+            case OP_GT: return left > right;
+            default: return left >= right;
+        }
     }
 
-    size_t handleJumpIfFalse(const Bytecode& instr, size_t pc) {
+    size_t handleJumpIfFalse(size_t target, size_t next) {
         if (operandStack.empty()) {
             throwRuntimeError("Stack underflow in jump if false");
         }
         Value cond = operandStack.top(); operandStack.pop();
-        if (cond.bignumValue == 0) {
-            return (std::get<BigNum>(instr.operand)).get_ll();
+        return branchIfFalse(cond, target, next);
+    }
+
+    size_t branchIfFalse(const Value& cond, size_t target, size_t next) {
+        if (isFalse(cond)) {
+            return target;
         }
-        return pc + 1;
+        return next;
     }
 
-    void handleBuildList(const Bytecode& instr) {
-        long long count = (std::get<BigNum>(instr.operand)).get_ll();
-        if (BigNum(operandStack.size()) < count) {
+    void handleBuildList(size_t count) {
+        if (operandStack.size() < count) {
             throwRuntimeError("Stack underflow in list construction");
         }
         std::vector<Value> elements;
-        for (int i = 0; i < count; i++) {
-            elements.insert(elements.begin(), operandStack.top());
+        elements.reserve(count);
+        for (size_t i = 0; i < count; i++) {
+            elements.push_back(std::move(operandStack.top()));
             operandStack.pop();
         }
-        operandStack.push(Value(elements));
+        std::reverse(elements.begin(), elements.end());
+        operandStack.push(Value(std::move(elements)));
     }
 
-    void handleCallFunction(const Bytecode& instr, Frame& currFrame) {
-        CallFunctionOperand op = std::get<CallFunctionOperand>(instr.operand);
+    // a + b + c + ... in one step: all-string operands are written into a
+    // single buffer sized up front, anything else is added left to right.
+    void handleConcat(size_t count) {
+        if (operandStack.size() < count) {
+            throwRuntimeError("Stack underflow in concatenation");
+        }
+        // Popped last operand first.
+        std::vector<Value> parts;
+        parts.reserve(count);
+        size_t size = 0;
+        bool strings = true;
+        for (size_t i = 0; i < count; i++) {
+            parts.push_back(std::move(operandStack.top()));
+            operandStack.pop();
+            strings = strings && parts.back().type == Value::STRING;
+            size += parts.back().strValue.size();
+        }
+
+        if (!strings) {
+            Value result = std::move(parts.back());
+            for (size_t i = count - 1; i-- > 0;) {
+                result = binaryOp(result, parts[i], OP_ADD);
+            }
+            operandStack.push(std::move(result));
+            return;
+        }
+
+        Value result{std::string()};
+        result.strValue.reserve(size);
+        for (size_t i = count; i-- > 0;) {
+            result.strValue += parts[i].strValue;
+        }
+        operandStack.push(std::move(result));
+    }
+
+    void handleBuildDict(size_t count) {
+        if (operandStack.size() < count * 2) {
+            throwRuntimeError("Stack underflow in dict construction");
+        }
+        std::vector<Value> items(count * 2);
+        for (size_t i = items.size(); i-- > 0;) {
+            items[i] = std::move(operandStack.top());
+            operandStack.pop();
+        }
+        auto dict = std::make_shared<Dict>();
+        for (size_t i = 0; i < items.size(); i += 2) {
+            dict->insert(items[i], std::move(items[i + 1]));
+        }
+        operandStack.push(Value(std::move(dict)));
+    }
+
+    void handleCallFunction(const CallFunctionOperand& op, Frame& currFrame) {
         std::vector<Value> args;
 
         for (int i = 0; i < op.argCount; i++) {
             if (operandStack.empty()) {
                 throwRuntimeError("Stack underflow in function call");
             }
-            args.insert(args.begin(), operandStack.top());
+            args.insert(args.begin(), std::move(operandStack.top()));
             operandStack.pop();
         }
 
@@ -486,7 +976,7 @@ private:
             }
 
             if (!DefaultValuesBytecodes.empty()) {
-                Frame defaultValFrame(DefaultValuesBytecodes, &frames.top());
+                Frame defaultValFrame(Assembler().assemble(DefaultValuesBytecodes), &frames.top());
                 frames.push(defaultValFrame);
                 execute();
                 
@@ -506,7 +996,7 @@ private:
             // printf("\n");
             
             if (self.functions.count(op.funcName)) {
-                Frame newFrame(method->bytecode, &frames.top());
+                Frame newFrame(compiledProgram(method), &frames.top());
                 
                 newFrame.locals["self"] = self;
                 
@@ -549,7 +1039,7 @@ private:
 
         if (!isMethodCall && functions.count(op.funcName)) {
             FunctionDeclaration* func = functions[op.funcName];
-            Frame newFrame(func->bytecode, &frames.top());
+            Frame newFrame(compiledProgram(func), &frames.top());
             for (size_t i = 0; i < func->parameters.size(); ++i) {
                 if (i < args.size()) {
                     newFrame.locals[func->parameters[i]] = args[i];
@@ -558,6 +1048,8 @@ private:
             frames.push(newFrame);
             result = execute();
             frames.pop();
+        } else if (!isMethodCall && !op.inPlaceTarget.empty()) {
+            result = callInPlace(op, args, currFrame);
         } else if (!isMethodCall) {
             result = callBuiltinFunction(op.funcName, args);
         }
@@ -566,7 +1058,22 @@ private:
         operandStack.push(result);
     }
 
-    Value callBuiltinFunction(const std::string& name, std::vector<Value> args) {
+    // x = append(x, ...) calling the builtin: x is cleared so that args[0]
+    // holds the only reference and the builtin updates it in place. The
+    // builtins leave args[0] alone when they fail, so x gets it back.
+    Value callInPlace(const CallFunctionOperand& op, std::vector<Value>& args, Frame& frame) {
+        auto it = frame.locals.find(op.inPlaceTarget);
+        if (it == frame.locals.end()) return callBuiltinFunction(op.funcName, args);
+        it->second = Value();
+        try {
+            return callBuiltinFunction(op.funcName, args);
+        } catch (...) {
+            it->second = std::move(args[0]);
+            throw;
+        }
+    }
+
+    Value callBuiltinFunction(const std::string& name, std::vector<Value>& args) {
         if (name == "print") {
             return builtinPrint(args);
         } else if (name == "input") {
@@ -581,6 +1088,8 @@ private:
             return builtinSleep(args);
         } else if (name == "system") {
             return builtinSystem(args);
+        } else if (name == "threads") {
+            return builtinThreads(args);
         } else if (name == "exit") {
             return builtinExit(args);
         } else if (name == "read") {
@@ -594,31 +1103,139 @@ private:
         } else if (name == "erase") {
             return listErase(args);
         } else if (name == "insert") {
+            if (!args.empty() && args[0].type == Value::SET) return setInsert(args);
             return listInsert(args);
+        } else if (name == "set") {
+            return builtinSet(args);
+        } else if (name == "union") {
+            return setUnion(args);
+        } else if (name == "intersection") {
+            return setIntersection(args);
+        } else if (name == "difference") {
+            return setDifference(args);
+        } else if (name == "join") {
+            return builtinJoin(args);
+        } else if (name == "find") {
+            return builtinFind(args);
+        } else if (name == "split") {
+            return builtinSplit(args);
+        } else if (name == "replace") {
+            return builtinReplace(args);
+        } else if (name == "strip") {
+            return builtinStrip(args);
+        } else if (name == "int64") {
+            return builtinInt64(args);
+        } else if (name == "float64") {
+            return builtinFloat64(args);
+        } else if (name == "sum") {
+            return arraySum(args);
+        } else if (name == "dot") {
+            return arrayDot(args);
+        } else if (name == "min") {
+            return arrayMin(args);
+        } else if (name == "max") {
+            return arrayMax(args);
+        } else if (name == "scale") {
+            return arrayScale(args);
+        } else if (name == "keys") {
+            return dictKeys(args);
+        } else if (name == "values") {
+            return dictValues(args);
+        } else if (name == "remove") {
+            if (!args.empty() && args[0].type == Value::SET) return setRemove(args);
+            return dictRemove(args);
         } else if (name == "floor") {
             return builtinMathFloor(args);
         } else if (name == "ceil") {
             return builtinMathCeil(args);
         } else if (name == "abs") {
             return builtinMathAbs(args);
+        } else if (name == "divmod") {
+            return builtinMathDivmod(args);
         } else if (name == "pow") {
             return builtinMathPow(args);
+        } else if (name == "powmod") {
+            return builtinMathPowmod(args);
+        } else if (name == "isqrt") {
+            return builtinMathIsqrt(args);
+        } else if (name == "gcd") {
+            return builtinMathGcd(args);
+        } else if (name == "lcm") {
+            return builtinMathLcm(args);
+        } else if (name == "modinv") {
+            return builtinMathModinv(args);
+        } else if (name == "is_prime") {
+            return builtinMathIsPrime(args);
         } else if (name == "round") {
             return builtinMathRound(args);
         } else if (name == "sqrt") {
             return builtinMathSqrt(args);
+        } else if (name == "precision") {
+            return builtinMathPrecision(args);
+        } else if (name == "exp") {
+            return builtinMathExp(args);
+        } else if (name == "ln") {
+            return builtinMathLn(args);
+        } else if (name == "sin") {
+            return builtinMathSin(args);
+        } else if (name == "cos") {
+            return builtinMathCos(args);
+        } else if (name == "atan") {
+            return builtinMathAtan(args);
+        } else if (name == "pi") {
+            return builtinMathPi(args);
         } else if (name == "list") {
             return builtinList(args);
         } else if (name == "str") {
             return builtinStr(args);
         } else if (name == "number") {
             return builtinNumber(args);
+        } else if (name == "float") {
+            return builtinFloat(args);
         } else {
             throwIdentifierError("Undefined builtin function: " + name);
             return Value();
         }
     }
 
+    // `return f(...)` of a user function: runs f in the current frame instead
+    // of a new one. The caller's locals stay in place under f's arguments,
+    // which is what f would see through the parent chain anyway, and the
+    // caller never reads them again. Method-shaped calls and builtins go
+    // through handleCallFunction; the following RETURN returns their result.
+    bool handleTailCall(const CallFunctionOperand& op, Frame& frame) {
+        if (!functions.count(op.funcName) || operandStack.size() < (size_t)op.argCount) {
+            handleCallFunction(op, frame);
+            return false;
+        }
+
+        std::vector<Value> args(op.argCount);
+        for (int i = op.argCount - 1; i >= 0; i--) {
+            args[i] = std::move(operandStack.top());
+            operandStack.pop();
+        }
+        if (args.size() > 1 && args[0].type == Value::OBJECT && args[1].type == Value::STRING) {
+            for (auto& arg : args) operandStack.push(std::move(arg));
+            handleCallFunction(op, frame);
+            return false;
+        }
+
+        FunctionDeclaration* func = functions[op.funcName];
+        for (size_t i = 0; i < func->parameters.size() && i < args.size(); ++i) {
+            frame.locals[func->parameters[i]] = std::move(args[i]);
+        }
+        frame.program = compiledProgram(func);
+        frame.pc = 0;
+        return true;
+    }
+
+    static const std::shared_ptr<CompiledProgram>& compiledProgram(FunctionDeclaration* func) {
+        if (!func->compiled) {
+            func->compiled = Assembler().assemble(func->bytecode);
+        }
+        return func->compiled;
+    }
+
     void handleReturn(Frame& frame) {
         if (!operandStack.empty()) {
             frame.returnValue = operandStack.top();
@@ -626,7 +1243,7 @@ private:
         } else {
             frame.returnValue = Value();
         }
-        frame.pc = frame.program.size();
+        frame.pc = frame.program->code.size();
     }
 };
 